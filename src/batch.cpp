@@ -0,0 +1,228 @@
+
+// includes
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch.hpp"
+#include "common.hpp"
+#include "fen.hpp"
+#include "gen.hpp"
+#include "libmy.hpp"
+#include "list.hpp"
+#include "move.hpp"
+#include "pos.hpp"
+#include "score.hpp"
+#include "search.hpp"
+#include "thread.hpp"
+#include "tt.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace batch {
+
+// types
+
+class Batch : public Lockable {
+
+private:
+
+   const Search_Input * m_si;
+
+   std::vector<std::string> m_pos;
+   std::vector<std::string> m_result;
+   std::vector<bool> m_done;
+
+   std::atomic<int> m_next {0};
+   int m_written {0}; // results are written in input order
+
+public:
+
+   void init (const std::string & file_name, const Search_Input & si);
+
+   void work (TT & tt);
+
+   int size () const { return int(m_pos.size()); }
+
+private:
+
+   std::string analyse (int i, TT & tt) const;
+
+   void add_result (int i, const std::string & result);
+};
+
+// prototypes
+
+static Pos parse_pos (const std::string & s);
+
+static std::string json_string (const std::string & s);
+
+// functions
+
+void run(const std::string & file_name, const Search_Input & si, int workers) {
+
+   assert(workers > 0);
+
+   Batch batch;
+   batch.init(file_name, si);
+
+   // one TT per worker, sharing the "tt-size" budget
+
+   int tt_size = var::TT_Size;
+   while (tt_size > (1 << 16) && int64(tt_size) * workers > int64(var::TT_Size)) tt_size /= 2;
+
+   std::vector<TT> tt(workers - 1);
+   for (TT & table : tt) table.set_size(tt_size);
+
+   G_TT.set_size(tt_size); // worker 0
+
+   Timer timer;
+   timer.start();
+
+   std::vector<std::thread> threads;
+
+   for (int id = 1; id < workers; id++) {
+      threads.emplace_back([&batch, &tt, id]() { batch.work(tt[id - 1]); });
+   }
+
+   batch.work(G_TT);
+
+   for (auto & thread : threads) {
+      thread.join();
+   }
+
+   timer.stop();
+
+   double time = timer.elapsed();
+   double speed = (time < 0.001) ? 0.0 : double(batch.size()) / time * 3600.0;
+
+   std::fprintf(stderr, "%d positions, %d workers, %.3f s, %.0f positions/hour\n", batch.size(), workers, time, speed);
+}
+
+void Batch::init(const std::string & file_name, const Search_Input & si) {
+
+   m_si = &si;
+
+   std::ifstream file(file_name);
+
+   if (!file) {
+      std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   std::string line;
+
+   while (std::getline(file, line)) {
+
+      line = ml::trim(line);
+      if (line.empty() || line[0] == '#') continue;
+
+      m_pos.push_back(line);
+   }
+
+   m_result.resize(m_pos.size());
+   m_done.resize(m_pos.size(), false);
+}
+
+void Batch::work(TT & tt) {
+
+   while (true) {
+
+      int i = m_next++;
+      if (i >= size()) break;
+
+      add_result(i, analyse(i, tt));
+   }
+}
+
+std::string Batch::analyse(int i, TT & tt) const {
+
+   std::string line = "{\"id\":" + std::to_string(i + 1) + ",\"pos\":" + json_string(m_pos[i]);
+
+   Pos pos;
+
+   try {
+      pos = parse_pos(m_pos[i]);
+   } catch (const Bad_Input &) {
+      return line + ",\"error\":\"bad position\"}";
+   }
+
+   List list;
+   gen_moves(list, pos);
+
+   if (list.size() == 0) return line + ",\"error\":\"no legal moves\"}";
+
+   Search_Input si = *m_si;
+   si.tt = &tt;
+
+   tt.clear(); // independent searches
+
+   Search_Output so;
+   search(so, Node(pos), si);
+
+   line += ",\"move\":" + json_string(move::to_hub(so.move, pos));
+   line += ",\"score\":" + ((so.score == score::None) ? std::string("null") : ml::ftos(double(so.score) / 100.0, 2));
+   line += ",\"depth\":" + std::to_string(so.depth);
+   line += ",\"nodes\":" + std::to_string(so.node);
+   line += ",\"time\":" + ml::ftos(so.time(), 3);
+   line += ",\"pv\":" + json_string(so.pv.to_hub(pos));
+   line += "}";
+
+   return line;
+}
+
+void Batch::add_result(int i, const std::string & result) {
+
+   lock();
+
+   m_result[i] = result;
+   m_done[i] = true;
+
+   while (m_written < size() && m_done[m_written]) {
+      std::cout << m_result[m_written] << std::endl;
+      m_result[m_written].clear();
+      m_written++;
+   }
+
+   unlock();
+}
+
+static Pos parse_pos(const std::string & s) { // FEN or hub
+
+   if (s.find(':') != std::string::npos) {
+      return pos_from_fen(s);
+   } else {
+      return pos_from_hub(s);
+   }
+}
+
+static std::string json_string(const std::string & s) { // quoted and escaped
+
+   std::string json = "\"";
+
+   for (char c : s) {
+
+      if (c == '"' || c == '\\') {
+         json += '\\';
+         json += c;
+      } else if (uint8(c) < 0x20) { // control character
+         char buf[8];
+         std::snprintf(buf, sizeof buf, "\\u%04x", uint8(c));
+         json += buf;
+      } else {
+         json += c;
+      }
+   }
+
+   return json + "\"";
+}
+
+} // namespace batch
+
@@ -0,0 +1,23 @@
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+// includes
+
+#include <string>
+
+#include "common.hpp"
+#include "libmy.hpp"
+
+class Search_Input;
+
+namespace batch {
+
+// functions
+
+void run (const std::string & file_name, const Search_Input & si, int workers);
+
+} // namespace batch
+
+#endif // !defined BATCH_HPP
+
@@ -1,21 +1,31 @@
 
 // includes
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "bb_base.hpp"
 #include "bb_comp.hpp"
 #include "bb_index.hpp"
 #include "common.hpp"
 #include "gen.hpp"
+#include "hash.hpp"
 #include "libmy.hpp"
 #include "list.hpp"
 #include "pos.hpp"
 #include "score.hpp"
+#include "util.hpp"
 #include "var.hpp"
 
 namespace bb {
@@ -24,6 +34,8 @@ namespace bb {
 
 const int Value_Size {4};
 
+const int Probe_Count {1 << 16}; // random probes per file to compare formats
+
 // types
 
 class Base {
@@ -41,9 +53,28 @@ public:
    ID    id   () const { return m_id; }
    Index size () const { return m_size; }
 
+   const Index_ & index () const { return m_index; }
+
    int operator [] (Index index) const { return m_index[index]; }
 };
 
+class Probe_Cache { // lock-free, key and value + 1 share one word
+
+private:
+
+   std::unique_ptr<std::atomic<uint64>[]> m_entry;
+   int m_mask {0};
+
+public:
+
+   void set_size (int size); // 2 ^ size entries, 0 = none
+
+   bool on () const { return m_entry != nullptr; }
+
+   int  probe (Key key) const; // Unknown if absent
+   void store (Key key, int value);
+};
+
 // "constants"
 
 const int Order[Value_Size] { 2, 0, 3, 1 }; // DLWU -> LUDW
@@ -51,31 +82,216 @@ const int Order[Value_Size] { 2, 0, 3, 1 }; // DLWU -> LUDW
 // variables
 
 static Base G_Base[ID_Size];
+static Probe_Cache G_Probe_Cache;
+static volatile int G_Probe_Sum {0}; // keeps the probes of probe_time() alive
 
 // prototypes
 
 static bool is_load (int size);
 
+static int probe_table (const Pos & pos);
+
+static double probe_time (const Index_ & index, const std::vector<Index> & pos);
+
 // functions
 
 void init() {
 
    std::cout << "init bitbase" << std::endl;
 
+   comp_set_avx2(var::BB_SIMD);
+   comp_set_cache(var::BB_Cache);
+
+   G_Probe_Cache.set_size(var::BB_Hash);
+
+   std::vector<ID> ids;
+
+   for (int i = 0; i < ID_Size; i++) {
+      ID id = ID(i);
+      if (id_is_load(id)) ids.push_back(id);
+   }
+
+   std::stable_sort(ids.begin(), ids.end(), [](ID i0, ID i1) { // largest first, for load balancing
+      return index_size(i0) > index_size(i1);
+   });
+
+   // load and index in parallel, one table at a time per thread
+
+   Timer timer;
+   timer.start();
+
+   int size = int(ids.size());
+   int threads = std::max(std::min(var::Threads, size), 1);
+
+   std::atomic<int> next {0};
+   std::atomic<int> done {0};
+   std::atomic<int64> bytes {0};
+
+   std::mutex mutex;
+   int step = 0; // progress, in tenths
+
+   auto work = [&]() {
+
+      for (int i = next++; i < size; i = next++) {
+
+         Base & base = G_Base[ids[i]];
+         base.load(ids[i]);
+         bytes += base.index().file_size();
+
+         int n = ++done;
+
+         std::lock_guard<std::mutex> lock(mutex);
+
+         while (step < n * 10 / size) {
+            step++;
+            std::cout << "bitbase " << step * 10 << "% (" << n << "/" << size << ")" << std::endl;
+         }
+      }
+   };
+
+   std::vector<std::thread> worker;
+
+   for (int i = 1; i < threads; i++) {
+      worker.emplace_back(work);
+   }
+
+   work();
+
+   for (std::thread & thread : worker) {
+      thread.join();
+   }
+
+   std::printf("bitbase %d tables, %.1f MiB, %.3f s, %d thread%s\n", size, double(bytes) / double(1 << 20), timer.elapsed(), threads, (threads > 1) ? "s" : "");
+   std::fflush(stdout);
+}
+
+void load(ID id) {
+   G_Base[id].load(id);
+}
+
+void convert() { // in place when smaller and faster, files are checked before replacement
+
+   int64 size_old = 0;
+   int64 size_new = 0;
+
+   double time_old = 0.0;
+   double time_new = 0.0;
+   int n = 0;
+
+   std::mt19937_64 gen; // fixed seed
+
    for (int i = 0; i < ID_Size; i++) {
 
       ID id = ID(i);
+      if (!id_is_load(id)) continue;
+
+      const Base & base = G_Base[id];
+      if (base.index().format() == Format_Block) continue;
+
+      std::string name = id_file(id);
+      std::string temp = name + ".tmp";
+
+      if (!base.index().save_block(temp)) {
+         std::cerr << "unable to write file \"" << temp << "\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      // check
+
+      Index_ copy;
+      copy.load(temp, base.size());
+
+      const Index Step {1 << 16};
+      std::vector<uint8> v0(Step), v1(Step);
+
+      for (Index pos = 0; pos < base.size(); pos += Step) {
+
+         Index size = std::min(Step, base.size() - pos);
+
+         base.index().decode(pos, size, v0.data());
+         copy.decode(pos, size, v1.data());
+
+         if (!std::equal(v0.begin(), v0.begin() + size, v1.begin())) {
+            std::cerr << "conversion mismatch: " << name << std::endl;
+            std::exit(EXIT_FAILURE);
+         }
+      }
+
+      // keep the new one only if it is both smaller (counting the RLE index) and faster to probe
+
+      int64 old_size = base.index().file_size() + base.index().memory_size();
+      int64 new_size = copy.file_size();
 
-      if (!id_is_illegal(id) && !id_is_end(id) && is_load(id_size(id))) {
-         G_Base[id].load(id);
+      std::vector<Index> index(Probe_Count);
+      for (Index & ix : index) ix = Index(gen() % base.size());
+
+      double old_time = probe_time(base.index(), index);
+      double new_time = probe_time(copy, index);
+
+      bool keep = new_size < old_size && new_time < old_time;
+
+      if (keep) {
+
+         if (std::rename(temp.c_str(), name.c_str()) != 0) {
+            std::cerr << "unable to rename file \"" << temp << "\"" << std::endl;
+            std::exit(EXIT_FAILURE);
+         }
+
+         std::remove((name + ".idx").c_str()); // RLE only
+
+      } else {
+
+         std::remove(temp.c_str());
       }
+
+      std::printf("%s %12lld -> %12lld bytes %7.1f -> %7.1f ns/probe%s\n", id_name(id).c_str(), (long long)old_size, (long long)new_size, old_time * 1E9, new_time * 1E9, keep ? "" : " (kept)");
+
+      size_old += old_size;
+      size_new += keep ? new_size : old_size;
+
+      time_old += old_time;
+      time_new += keep ? new_time : old_time;
+      n++;
+   }
+
+   if (n != 0) {
+      std::printf("\n");
+      std::printf("total %lld -> %lld bytes (%.1f%%)\n", (long long)size_old, (long long)size_new, double(size_new) / double(size_old) * 100.0);
+      std::printf("probe %.1f -> %.1f ns (mean over IDs)\n", time_old / double(n) * 1E9, time_new / double(n) * 1E9);
    }
 }
 
+static double probe_time(const Index_ & index, const std::vector<Index> & pos) { // seconds per probe, best of 3
+
+   int sum = 0; // keep the probes alive
+
+   for (Index ix : pos) sum += index.probe(ix); // warm-up (page faults)
+
+   double best = 1E9;
+
+   for (int i = 0; i < 3; i++) {
+
+      Timer timer;
+      timer.start();
+
+      for (Index ix : pos) sum += index.probe(ix);
+
+      best = std::min(best, timer.elapsed());
+   }
+
+   G_Probe_Sum += sum;
+
+   return best / double(pos.size());
+}
+
 static bool is_load(int size) {
    return var::BB && size <= var::BB_Size;
 }
 
+bool id_is_load(ID id) {
+   return !id_is_illegal(id) && !id_is_end(id) && is_load(id_size(id));
+}
+
 bool pos_is_load(const Pos & pos) {
    return is_load(pos::size(pos));
 }
@@ -88,30 +304,59 @@ int probe(const Pos & pos) {
 
    if (pos::is_wipe(pos)) return value_from_nega(pos::result(pos, pos.turn())); // for BT variant
 
+   Key key {};
+
+   if (G_Probe_Cache.on()) {
+      key = hash::key(pos);
+      int value = G_Probe_Cache.probe(key);
+      if (value != Unknown) return value;
+   }
+
    List list;
    gen_captures(list, pos);
 
+   int node;
+
    if (list.size() == 0) { // quiet position
 
-      return probe_raw(pos);
+      node = probe_table(pos);
 
    } else { // capture position
 
-      int node = Loss;
+      node = Loss;
 
       for (Move mv : list) {
          node = value_update(node, probe(pos.succ(mv)));
          if (node == Win) break;
       }
-
-      return node;
    }
+
+   if (G_Probe_Cache.on()) G_Probe_Cache.store(key, node);
+
+   return node;
 }
 
 int probe_raw(const Pos & pos) {
 
    assert(!pos::is_capture(pos));
 
+   if (!G_Probe_Cache.on()) return probe_table(pos);
+
+   Key key = hash::key(pos);
+   int value = G_Probe_Cache.probe(key);
+
+   if (value == Unknown) {
+      value = probe_table(pos);
+      G_Probe_Cache.store(key, value);
+   }
+
+   return value;
+}
+
+static int probe_table(const Pos & pos) {
+
+   assert(!pos::is_capture(pos));
+
    ID id = pos_id(pos);
    assert(!id_is_illegal(id));
    if (id_is_end(id)) return (var::Variant == var::Losing) ? Win : Loss;
@@ -125,13 +370,53 @@ int probe_raw(const Pos & pos) {
    return value;
 }
 
+int probe_index(ID id, Index index) {
+   assert(id_is_load(id));
+   assert(index < G_Base[id].size());
+   return G_Base[id][index];
+}
+
+void Probe_Cache::set_size(int size) {
+
+   if (size == 0) {
+      m_entry.reset();
+      return;
+   }
+
+   m_entry.reset(new std::atomic<uint64>[std::size_t(1) << size]);
+   m_mask = (1 << size) - 1;
+
+   for (int i = 0; i <= m_mask; i++) {
+      m_entry[i].store(0, std::memory_order_relaxed);
+   }
+}
+
+int Probe_Cache::probe(Key key) const {
+
+   uint64 entry = m_entry[hash::index(key, m_mask)].load(std::memory_order_relaxed);
+
+   if (entry != 0 && (entry ^ uint64(key)) >> 2 == 0) { // 0 = empty
+      return int(entry & 3) - 1;
+   } else {
+      return Unknown;
+   }
+}
+
+void Probe_Cache::store(Key key, int value) {
+   assert(value >= 0 && value < Unknown);
+   m_entry[hash::index(key, m_mask)].store((uint64(key) & ~uint64(3)) | uint64(value + 1), std::memory_order_relaxed);
+}
+
 void Base::load(ID id) {
 
    m_id = id;
    m_size = index_size(id);
 
-   std::string file_name = std::string("data/bb") + var::variant_name() + "/" + std::to_string(id_size(id)) + "/" + id_name(id);
-   m_index.load(file_name, m_size);
+   m_index.load(id_file(id), m_size);
+}
+
+std::string id_file(ID id) {
+   return std::string("data/bb") + var::variant_name() + "/" + std::to_string(id_size(id)) + "/" + id_name(id);
 }
 
 int value_update(int node, int child) {
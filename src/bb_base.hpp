@@ -6,6 +6,7 @@
 
 #include <string>
 
+#include "bb_index.hpp"
 #include "common.hpp"
 #include "libmy.hpp"
 
@@ -19,7 +20,11 @@ enum Value : int { Draw, Loss, Win, Unknown };
 
 // functions
 
-void init ();
+void init    ();
+void convert (); // loaded bitbases -> block format
+void load    (ID id); // one table, for the generator
+
+std::string id_file (ID id); // "data/bb<variant>/<size>/<name>"
 
 bool pos_is_load   (const Pos & pos);
 bool pos_is_search (const Pos & pos, int bb_size);
@@ -27,6 +32,9 @@ bool pos_is_search (const Pos & pos, int bb_size);
 int probe     (const Pos & pos); // QS
 int probe_raw (const Pos & pos); // quiet position
 
+bool id_is_load  (ID id);
+int  probe_index (ID id, Index index); // raw table access
+
 int value_update (int node, int child);
 
 int value_age (int val);
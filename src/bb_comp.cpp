@@ -2,11 +2,25 @@
 // includes
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
+
+#if defined _MSC_VER && defined _M_X64
+#include <immintrin.h>
+#define AVX2
+#define TARGET_AVX2
+#elif defined __x86_64__
+#include <immintrin.h>
+#define AVX2
+#define TARGET_AVX2 __attribute__((target("avx2"))) // runtime dispatch, no -mavx2 needed
+#endif
 
 #include "bb_comp.hpp"
 #include "common.hpp"
@@ -19,14 +33,92 @@ namespace bb {
 
 const int RLE_Size {255 / 3};
 
-const Index Block_Size {1 << 8};
+const uint64 Stride_Bytes {128}; // compressed bytes per stride on average (memory vs. scan length)
+const int Entry_Shift {8}; // byte entries every 256 compressed bytes => at most 256 codes scanned
+
+const uint64 Index_Magic {0x3449424E414353}; // "SCANBI4" (index sidecar)
+
+const uint64 Block_Magic {0x3342424E4143FF}; // 0xFF "CANBB3", 0xFF is not an RLE code
+const int Block_Shift {13}; // 8192 positions per block
+const int Sub_Shift {8}; // RLE blocks: one entry point every 256 positions
+
+const int Cache_Shift {10}; // 1024 positions per cached block
+
+const uint64 Cache_Empty {0}; // slot keys
+const uint64 Cache_Busy  {1};
+
+// types
+
+enum Block_Mode : int { Block_Constant, Block_Packed, Block_Runs, Block_RLE }; // low 2 bits of a block's first byte
+
+struct Block_Header { // followed by the directory (block count + 1 offsets) and the blocks
+   uint64 magic;
+   uint64 size;  // uncompressed
+   uint64 shift; // block = 2 ^ shift positions
+   uint64 count; // blocks
+};
+
+struct Index_Header {
+   uint64 magic;
+   uint64 entry_size;  // sizeof(Stride)
+   uint64 entry_shift; // byte entry = 2 ^ entry_shift compressed bytes
+   uint64 shift;       // stride = 2 ^ shift positions
+   uint64 table_size; // compressed
+   uint64 size;       // uncompressed
+};
+
+struct Cache_Slot { // sequence lock: readers check the key again after reading a word
+   std::atomic<uint64> key;
+   std::atomic<uint64> value[(1 << Cache_Shift) / 32]; // 2 bits per position
+};
+
+class Block_Cache { // shared by all threads and kept between searches, lock-free
+
+private:
+
+   std::unique_ptr<Cache_Slot[]> m_slot;
+   int m_mask {0};
+
+public:
+
+   void set_size (int size); // KiB, 0 = none
+
+   bool on () const { return m_slot != nullptr; }
+
+   int probe (const Index_ & index, Index pos);
+};
 
 // variables
 
 static Index RLE[RLE_Size + 1];
 
 static int Code_Value[256];
-static Index Code_Length[256];
+static uint32 Code_Length[256]; // 32-bit for the AVX2 gather
+
+static bool G_Has_AVX2 {false};
+static bool G_AVX2 {false};
+
+static Block_Cache G_Cache;
+
+static thread_local int64 G_Cache_Hit {0}; // attributed to the probing thread (and so to its search)
+static thread_local int64 G_Cache_Miss {0};
+
+// prototypes
+
+static int load_16 (const uint8 * p);
+
+static int rle_find        (const uint8 * p, const uint8 * end, Index pos);
+static int rle_find_scalar (const uint8 * p, Index pos);
+
+#ifdef AVX2
+static bool    cpu_has_avx2  ();
+static __m256i prefix_sum    (__m256i x);
+static int     rle_find_avx2 (const uint8 * p, const uint8 * end, Index pos);
+#endif
+
+static void encode_block (std::vector<uint8> & table, const uint8 * value, int size);
+static void decode_block (const uint8 * block, int begin, int size, uint8 * value);
+static int  rle_code     (Index len);
 
 // functions
 
@@ -40,40 +132,404 @@ void comp_init() {
       Code_Value[byte]  = byte % 3;
       Code_Length[byte] = RLE[byte / 3];
    }
+
+#ifdef AVX2
+   G_Has_AVX2 = cpu_has_avx2();
+#endif
 }
 
-void Index_::load(const std::string & file_name, Index size) {
+void comp_set_cache(int size) { // call when no thread is probing
+   G_Cache.set_size(size); // also empties it (tables may have been reloaded)
+}
 
-   std::ifstream file(file_name, std::ios::binary);
+void comp_cache_stats(int64 & hit, int64 & miss) {
+   hit  = G_Cache_Hit;
+   miss = G_Cache_Miss;
+}
+
+bool comp_cache() {
+   return G_Cache.on();
+}
 
-   if (!file) {
+bool comp_has_avx2() {
+   return G_Has_AVX2;
+}
+
+bool comp_avx2() {
+   return G_AVX2;
+}
+
+void comp_set_avx2(bool avx2) {
+   G_AVX2 = avx2 && G_Has_AVX2;
+}
+
+void Index_::load(const std::string & file_name, Index size) {
+
+   if (!m_file.open(file_name)) {
       std::cerr << "unable to open file \"" << file_name << "\"" << std::endl;
       std::exit(EXIT_FAILURE);
    }
 
    m_size = size;
-   load_file(m_table, file);
+   m_table = m_file.data(); // mapped, pages are read on first probe
+
+   if (load_block(file_name)) {
+      m_format = Format_Block;
+      return;
+   }
+
+   m_format = Format_RLE;
+
+   // index table for on-line decompression, cached next to the file
+
+   if (!load_index(file_name + ".idx")) {
+      make_index(file_name);
+      save_index(file_name + ".idx"); // can fail (read-only directory)
+      if (!load_index(file_name + ".idx")) m_index_file.close(); // mapped rather than private when possible
+   }
+}
+
+bool Index_::load_block(const std::string & file_name) {
+
+   Block_Header header;
+
+   if (m_file.size() < int64(sizeof header)) return false;
+   std::copy(m_table, m_table + sizeof header, (uint8 *) &header);
+
+   if (header.magic != Block_Magic) {
+
+      if ((header.magic & 0xFF) == 0xFF) { // not an RLE code
+         std::cerr << "unsupported bitbase format (convert the original files again): " << file_name << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      return false;
+   }
+
+   uint64 count = (uint64(m_size) + (uint64(1) << header.shift) - 1) >> header.shift;
+
+   if (header.size != uint64(m_size)
+    || header.shift != uint64(Block_Shift)
+    || header.count != count
+    || int64(sizeof header + (count + 1) * sizeof(uint64)) > m_file.size()
+      ) {
+      std::cerr << "corrupted bitbase file: " << file_name << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   m_block = reinterpret_cast<const uint64 *>(m_table + sizeof header); // mapping is page-aligned
+   m_block_shift = int(header.shift);
+
+   if (m_block[count] != uint64(m_file.size())) {
+      std::cerr << "corrupted bitbase file: " << file_name << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   return true;
+}
+
+bool Index_::save_block(const std::string & file_name) const {
+
+   uint64 count = (uint64(m_size) + (uint64(1) << Block_Shift) - 1) >> Block_Shift;
+
+   Block_Header header { Block_Magic, uint64(m_size), uint64(Block_Shift), count };
+
+   std::vector<uint8> table;
+   std::vector<uint64> dir;
+   dir.reserve(count + 1);
+
+   uint64 start = sizeof header + (count + 1) * sizeof(uint64);
+   uint8 value[1 << Block_Shift];
+
+   for (uint64 i = 0; i < count; i++) {
+
+      Index pos = Index(i << Block_Shift);
+      int size = int(std::min(uint64(m_size) - pos, uint64(1) << Block_Shift));
+
+      decode(pos, Index(size), value);
+
+      dir.push_back(start + table.size());
+      encode_block(table, value, size);
+   }
+
+   dir.push_back(start + table.size());
+
+   std::ofstream file(file_name, std::ios::binary);
+   if (!file) return false;
+
+   file.write((const char *) &header, sizeof header);
+   file.write((const char *) dir.data(), dir.size() * sizeof(uint64));
+   file.write((const char *) table.data(), table.size());
+
+   return bool(file);
+}
+
+bool comp_save(const std::string & file_name, const uint8 * value, Index size) {
+
+   std::vector<uint8> table;
+
+   for (Index i = 0, len = 1; i < size; i++, len++) {
+
+      assert(value[i] < 3);
+
+      if (i + 1 == size || value[i + 1] != value[i]) { // end of run
+
+         for (Index left = len; left != 0;) {
+            int code = rle_code(left);
+            table.push_back(uint8(code * 3 + value[i]));
+            left -= RLE[code];
+         }
+
+         len = 0;
+      }
+   }
+
+   std::ofstream file(file_name, std::ios::binary);
+   if (!file) return false;
+
+   file.write((const char *) table.data(), table.size());
+
+   return bool(file);
+}
+
+static void encode_block(std::vector<uint8> & table, const uint8 * value, int size) { // smallest of 4 modes
+
+   int runs = 1;
+   int codes = 0; // RLE bytes
+
+   for (int i = 0, len = 1; i < size; i++, len++) {
+
+      if (i + 1 == size || value[i + 1] != value[i]) { // end of run
+
+         for (Index left = len; left != 0; left -= RLE[rle_code(left)]) {
+            codes++;
+         }
+
+         if (i + 1 != size) runs++;
+         len = 0;
+      }
+   }
+
+   if (runs == 1) {
+      table.push_back(uint8(Block_Constant | value[0] << 2));
+      return;
+   }
+
+   int subs = ((size - 1) >> Sub_Shift) + 1;
+
+   int packed_size = (size + 3) / 4;
+   int runs_size = 2 + runs * 2;
+   int rle_size = 1 + subs * 4 + codes;
+
+   if (rle_size < packed_size && rle_size < runs_size) { // same codes as the RLE format, with entry points
+
+      table.push_back(uint8(Block_RLE));
+      table.push_back(uint8(subs));
+
+      std::size_t entry = table.size();
+      table.resize(entry + subs * 4);
+
+      std::size_t begin = table.size();
+      int pos = 0; // start of the next code
+
+      for (int i = 0, len = 1; i < size; i++, len++) {
+
+         if (i + 1 == size || value[i + 1] != value[i]) {
+
+            for (Index left = len; left != 0;) {
+
+               int code = rle_code(left);
+               int end = pos + int(RLE[code]);
+
+               for (int s = (pos + (1 << Sub_Shift) - 1) >> Sub_Shift; s < subs && (s << Sub_Shift) < end; s++) { // byte offset and skip
+                  int byte = int(table.size() - begin);
+                  int skip = (s << Sub_Shift) - pos;
+                  table[entry + s * 4 + 0] = uint8(byte);
+                  table[entry + s * 4 + 1] = uint8(byte >> 8);
+                  table[entry + s * 4 + 2] = uint8(skip);
+                  table[entry + s * 4 + 3] = uint8(skip >> 8);
+               }
+
+               table.push_back(uint8(code * 3 + value[i]));
+               left -= RLE[code];
+               pos = end;
+            }
+
+            len = 0;
+         }
+      }
+
+   } else if (packed_size <= runs_size) {
+
+      table.push_back(uint8(Block_Packed));
+
+      std::size_t begin = table.size();
+      table.resize(begin + packed_size, 0);
+
+      for (int i = 0; i < size; i++) {
+         table[begin + i / 4] |= value[i] << (i % 4 * 2);
+      }
+
+   } else { // sorted run ends (exclusive) with the value in the 2 low bits
+
+      table.push_back(uint8(Block_Runs));
+      table.push_back(uint8(runs));
+      table.push_back(uint8(runs >> 8));
+
+      for (int i = 0; i < size; i++) {
+         if (i + 1 == size || value[i + 1] != value[i]) {
+            int entry = (i + 1) << 2 | value[i];
+            table.push_back(uint8(entry));
+            table.push_back(uint8(entry >> 8));
+         }
+      }
+   }
+}
+
+static void decode_block(const uint8 * block, int begin, int size, uint8 * value) { // positions [begin, begin + size) of the block
+
+   switch (block[0] & 3) {
+
+      case Block_Constant :
+
+         std::fill(value, value + size, uint8(block[0] >> 2));
+         break;
+
+      case Block_Packed :
+
+         for (int i = begin; i < begin + size; i++) {
+            *value++ = (block[1 + i / 4] >> (i % 4 * 2)) & 3;
+         }
+
+         break;
+
+      case Block_RLE : { // start from the entry point
+
+         const uint8 * entry = block + 2 + (begin >> Sub_Shift) * 4;
+         const uint8 * p = block + 2 + block[1] * 4 + load_16(entry);
+
+         uint32 skip = (begin & ((1 << Sub_Shift) - 1)) + load_16(entry + 2);
+
+         while (skip >= Code_Length[*p]) {
+            skip -= Code_Length[*p];
+            p++;
+         }
+
+         for (; size != 0; p++) {
+            int len = int(std::min(Code_Length[*p] - skip, uint32(size)));
+            std::fill(value, value + len, uint8(Code_Value[*p]));
+            value += len;
+            size -= len;
+            skip = 0;
+         }
+
+         break;
+      }
+
+      default : { // runs
+
+         const uint8 * run = block + 3;
+         while ((load_16(run) >> 2) <= begin) run += 2; // first run that ends after "begin"
+
+         for (int i = begin; i < begin + size; run += 2) {
+            int entry = load_16(run);
+            for (; i < (entry >> 2) && i < begin + size; i++) *value++ = entry & 3;
+         }
+
+         break;
+      }
+   }
+}
+
+static int rle_code(Index len) { // longest code that fits
+
+   assert(len != 0);
+   return int(std::upper_bound(RLE, RLE + RLE_Size, len) - RLE) - 1;
+}
+
+void Index_::decode(Index pos, Index size, uint8 * out) const {
+
+   assert(pos + size <= m_size);
+
+   if (m_format == Format_Block) { // only the requested range of each block
 
-   // create index table for on-line decompression
+      while (size != 0) {
 
-   Index table_size = Index(m_table.size());
-   Index index_size = (table_size + Block_Size - 1) / Block_Size;
+         Index i = pos & ((Index(1) << m_block_shift) - 1);
+         Index n = std::min(size, (Index(1) << m_block_shift) - i);
+
+         decode_block(m_table + m_block[pos >> m_block_shift], int(i), int(n), out);
+
+         pos += n;
+         size -= n;
+         out += n;
+      }
+
+      return;
+   }
+
+   // find the first run
+
+   Index i;
+   find_run(pos, i, pos);
+
+   while (pos >= Code_Length[m_table[i]]) {
+      pos -= Code_Length[m_table[i]];
+      i++;
+   }
+
+   // expand the runs
+
+   Index left = Code_Length[m_table[i]] - pos;
+
+   for (Index j = 0; j < size; j++) {
+
+      if (left == 0) {
+         i++;
+         left = Code_Length[m_table[i]];
+      }
+
+      out[j] = Code_Value[m_table[i]];
+      left--;
+   }
+}
+
+void Index_::make_index(const std::string & file_name) { // reads the whole file
+
+   Index table_size = Index(m_file.size());
+
+   // largest power-of-two stride that spans at most Stride_Bytes compressed bytes on average
+
+   m_shift = 0;
+
+   while (m_shift < 31 && (uint64(1) << (m_shift + 1)) * uint64(table_size) <= uint64(m_size) * Stride_Bytes) {
+      m_shift++;
+   }
+
+   Index index_size = ((m_size - 1) >> m_shift) + 1;
+   Index entry_size = ((table_size - 1) >> Entry_Shift) + 1;
 
    m_index.clear();
-   m_index.reserve(index_size + 1); // sentinel for debug
+   m_index.reserve(index_size);
+
+   m_index_entry.clear();
+   m_index_entry.reserve(entry_size);
 
    Index pos = 0;
 
-   for (Index i = 0; i < table_size;) {
+   for (Index i = 0; i < table_size; i++) {
 
-      assert(i % Block_Size == 0);
-      m_index.push_back(pos);
+      if ((i & ((Index(1) << Entry_Shift) - 1)) == 0) m_index_entry.push_back(pos);
 
-      Index next = std::min(i + Block_Size, table_size);
+      Index len = Code_Length[m_table[i]];
 
-      for (; i < next; i++) {
-         pos += Code_Length[m_table[i]];
+      while (Index(m_index.size()) < index_size && (Index(m_index.size()) << m_shift) < pos + len) {
+         Index start = Index(m_index.size()) << m_shift;
+         assert(start >= pos && start - pos < (Index(1) << 24));
+         m_index.push_back({ i, start - pos });
       }
+
+      pos += len;
    }
 
    if (pos != m_size) {
@@ -82,51 +538,347 @@ void Index_::load(const std::string & file_name, Index size) {
    }
 
    assert(Index(m_index.size()) == index_size);
-   m_index.push_back(m_size); // sentinel for debug
+   assert(Index(m_index_entry.size()) == entry_size);
+
+   m_stride = m_index.data();
+   m_stride_size = index_size;
+
+   m_entry = m_index_entry.data();
+   m_entry_size = entry_size;
+}
+
+bool Index_::load_index(const std::string & file_name) {
+
+   if (!m_index_file.open(file_name)) return false;
+
+   Index_Header header;
+
+   if (m_index_file.size() < int64(sizeof header)) return false;
+   std::copy(m_index_file.data(), m_index_file.data() + sizeof header, (uint8 *) &header);
+
+   Index table_size = Index(m_file.size());
+
+   if (header.magic != Index_Magic
+    || header.entry_size != sizeof(Stride)
+    || header.entry_shift != uint64(Entry_Shift)
+    || header.shift > 31
+    || header.table_size != uint64(table_size)
+    || header.size != uint64(m_size)
+      ) {
+      return false; // stale or foreign sidecar => rebuild
+   }
+
+   Index index_size = ((m_size - 1) >> header.shift) + 1;
+   Index entry_size = ((table_size - 1) >> Entry_Shift) + 1;
+   if (uint64(m_index_file.size()) != sizeof header + index_size * sizeof(Stride) + entry_size * sizeof(Index)) return false;
+
+   const Stride * stride = reinterpret_cast<const Stride *>(m_index_file.data() + sizeof header); // mapping is page-aligned
+   if (stride[0].byte != 0 || stride[0].skip != 0 || stride[index_size - 1].byte >= table_size) return false;
+
+   const Index * entry = reinterpret_cast<const Index *>(stride + index_size);
+   if (entry[0] != 0 || entry[entry_size - 1] >= m_size) return false;
+
+   m_shift = int(header.shift);
+   m_stride = stride;
+   m_stride_size = index_size;
+
+   m_entry = entry;
+   m_entry_size = entry_size;
+
+   std::vector<Stride>().swap(m_index); // free the copies built by "make_index"
+   std::vector<Index>().swap(m_index_entry);
+
+   return true;
+}
+
+void Index_::save_index(const std::string & file_name) const {
+
+   std::string temp = file_name + ".tmp"; // other processes can have the old one mapped
+
+   std::ofstream file(temp, std::ios::binary);
+   if (!file) return;
+
+   Index_Header header { Index_Magic, sizeof(Stride), uint64(Entry_Shift), uint64(m_shift), uint64(m_file.size()), uint64(m_size) };
+
+   file.write((const char *) &header, sizeof header);
+   file.write((const char *) m_stride, m_stride_size * sizeof(Stride));
+   file.write((const char *) m_entry, m_entry_size * sizeof(Index));
+   file.close();
+
+   if (!file || std::rename(temp.c_str(), file_name.c_str()) != 0) std::remove(temp.c_str());
+}
+
+int64 Index_::memory_size() const {
+   return (m_format == Format_RLE) ? int64(m_stride_size * sizeof(Stride) + m_entry_size * sizeof(Index)) : 0;
 }
 
 int Index_::operator[](Index pos) const {
 
    assert(pos < m_size);
 
-   // find the compressed block using the index table
+   if (G_Cache.on()) {
+      return G_Cache.probe(*this, pos);
+   } else {
+      return probe(pos);
+   }
+}
+
+int Index_::probe(Index pos) const {
+   assert(pos < m_size);
+   return (m_format == Format_Block) ? probe_block(pos) : probe_rle(pos);
+}
+
+void Index_::find_run(Index pos, Index & byte, Index & skip) const { // at most 2 ^ Entry_Shift codes before "pos"
 
-   Index low = 0;
-   Index high = m_index.size() - 1;
-   assert(low <= high);
+   Index table_size = Index(m_file.size());
+
+   // stride index
+
+   Index k = pos >> m_shift;
+   const Stride & stride = m_stride[k];
+
+   byte = stride.byte;
+   skip = (pos & ((Index(1) << m_shift) - 1)) + stride.skip;
+
+   Index end = (k + 1 < m_stride_size) ? Index(m_stride[k + 1].byte) : table_size - 1; // last code to scan
+   if (end - byte <= (Index(1) << Entry_Shift)) return;
+
+   // long stride => last byte entry at or before "pos", if any is inside
+
+   Index low = (byte >> Entry_Shift) + 1;
+   Index high = end >> Entry_Shift;
+
+   if (low > high || m_entry[low] > pos) return;
 
    while (low < high) {
 
       Index mid = (low + high + 1) / 2;
-      assert(mid > low && mid <= high);
 
-      if (m_index[mid] <= pos) {
+      if (m_entry[mid] <= pos) {
          low = mid;
-         assert(low <= high);
       } else {
          high = mid - 1;
-         assert(low <= high);
       }
    }
 
-   assert(low == high);
-   assert(m_index[low] <= pos);
-   assert(m_index[low + 1] > pos);
+   byte = low << Entry_Shift;
+   skip = pos - m_entry[low];
+}
+
+int Index_::probe_rle(Index pos) const {
+
+   // find the run using the index
+
+   Index byte, skip;
+   find_run(pos, byte, skip);
 
    // find the value using on-line RLE
 
-   assert(pos >= m_index[low]);
-   pos -= m_index[low];
+   return rle_find(m_table + byte, m_table + m_file.size(), skip);
+}
+
+int Index_::probe_block(Index pos) const {
+
+   const uint8 * block = m_table + m_block[pos >> m_block_shift];
+   int i = int(pos & ((Index(1) << m_block_shift) - 1));
+
+   switch (block[0] & 3) {
+
+      case Block_Constant :
+
+         return block[0] >> 2;
+
+      case Block_Packed :
+
+         return (block[1 + i / 4] >> (i % 4 * 2)) & 3;
 
-   for (Index i = low * Block_Size; true; i++) {
+      case Block_RLE : { // scan from the entry point
 
-      int byte = m_table[i];
+         const uint8 * entry = block + 2 + (i >> Sub_Shift) * 4;
+         const uint8 * code = block + 2 + block[1] * 4 + load_16(entry);
 
-      Index len = Code_Length[byte];
-      if (pos < len) return Code_Value[byte];
+         return rle_find(code, m_table + m_file.size(), Index((i & ((1 << Sub_Shift) - 1)) + load_16(entry + 2)));
+      }
+
+      default : { // runs, binary search for the first end > i
+
+         int low = 0;
+         int high = load_16(block + 1) - 1;
+
+         const uint8 * run = block + 3;
+
+         while (low < high) {
+
+            int mid = (low + high) / 2;
+
+            if ((load_16(run + mid * 2) >> 2) > i) {
+               high = mid;
+            } else {
+               low = mid + 1;
+            }
+         }
+
+         return load_16(run + low * 2) & 3;
+      }
+   }
+}
+
+static int rle_find(const uint8 * p, const uint8 * end, Index pos) { // value of position "pos" in the runs starting at p
+
+#ifdef AVX2
+   if (G_AVX2 && pos < (Index(1) << 30)) return rle_find_avx2(p, end, pos); // signed 32-bit lanes
+#endif
+
+   return rle_find_scalar(p, pos);
+}
+
+static int rle_find_scalar(const uint8 * p, Index pos) {
+
+   for (; true; p++) {
+      Index len = Code_Length[*p];
+      if (pos < len) return Code_Value[*p];
       pos -= len;
    }
 }
 
+#ifdef AVX2
+
+static bool cpu_has_avx2() {
+
+#ifdef _MSC_VER
+   int reg[4];
+   __cpuid(reg, 1);
+   if ((reg[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) return false; // OS saves YMM registers
+   __cpuidex(reg, 7, 0);
+   return (reg[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+
+TARGET_AVX2 static __m256i prefix_sum(__m256i x) { // inclusive, 8 lanes
+   x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+   x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+   return _mm256_add_epi32(x, _mm256_permute2x128_si256(_mm256_shuffle_epi32(x, 0xFF), x, 0x08)); // low half total -> high half
+}
+
+TARGET_AVX2 static int rle_find_avx2(const uint8 * p, const uint8 * end, Index pos) { // 16 codes per step
+
+   static_assert(sizeof(Code_Length[0]) == 4, "32-bit gather");
+
+   const int * length = reinterpret_cast<const int *>(Code_Length);
+   const __m256i last = _mm256_set1_epi32(7);
+
+   __m256i target = _mm256_set1_epi32(int(pos));
+
+   for (; p + 16 <= end; p += 16) { // don't read past the mapping
+
+      __m128i code = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+
+      __m256i sum_0 = prefix_sum(_mm256_i32gather_epi32(length, _mm256_cvtepu8_epi32(code), 4));
+      __m256i sum_1 = prefix_sum(_mm256_i32gather_epi32(length, _mm256_cvtepu8_epi32(_mm_srli_si128(code, 8)), 4));
+      sum_1 = _mm256_add_epi32(sum_1, _mm256_permutevar8x32_epi32(sum_0, last));
+
+      // first run that ends after the target
+
+      int mask_0 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(sum_0, target)));
+      int mask_1 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(sum_1, target)));
+      int mask = mask_0 | mask_1 << 8;
+
+      if (mask != 0) return Code_Value[p[ml::bit_first(mask)]];
+
+      target = _mm256_sub_epi32(target, _mm256_permutevar8x32_epi32(sum_1, last));
+   }
+
+   return rle_find_scalar(p, Index(_mm256_cvtsi256_si32(target)));
+}
+
+#endif
+
+void Block_Cache::set_size(int size) {
+
+   int64 slots = int64(size) * 1024 / int64(sizeof(Cache_Slot));
+
+   if (slots == 0) {
+      m_slot.reset();
+      m_mask = 0;
+      return;
+   }
+
+   int n = 1; // largest power of two that fits
+   while (int64(n) * 2 <= slots) n *= 2;
+
+   m_slot.reset(new Cache_Slot[n]);
+   m_mask = n - 1;
+
+   for (int i = 0; i < n; i++) {
+      m_slot[i].key.store(Cache_Empty, std::memory_order_relaxed);
+   }
+}
+
+int Block_Cache::probe(const Index_ & index, Index pos) {
+
+   Index block = pos >> Cache_Shift;
+   int i = int(pos & ((Index(1) << Cache_Shift) - 1));
+
+   uint64 key = (uint64(reinterpret_cast<std::uintptr_t>(&index)) << 32 ^ uint64(block)) * 0x9E3779B97F4A7C15;
+   if (key <= Cache_Busy) key += 2; // reserved
+
+   Cache_Slot & slot = m_slot[int(key >> 32) & m_mask];
+
+   // hit?
+
+   if (slot.key.load(std::memory_order_acquire) == key) {
+
+      uint64 word = slot.value[i / 32].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (slot.key.load(std::memory_order_relaxed) == key) { // not rewritten meanwhile
+         G_Cache_Hit += 1;
+         return (word >> (i % 32 * 2)) & 3;
+      }
+   }
+
+   // miss => decode the slot's positions only
+
+   G_Cache_Miss += 1;
+
+   Index start = block << Cache_Shift;
+   Index size = std::min(index.size() - start, Index(1) << Cache_Shift);
+
+   uint8 value[1 << Cache_Shift];
+   index.decode(start, size, value);
+
+   // store, unless another thread is writing this slot
+
+   uint64 old = slot.key.load(std::memory_order_relaxed);
+
+   if (old != Cache_Busy && slot.key.compare_exchange_strong(old, Cache_Busy, std::memory_order_relaxed)) {
+
+      std::atomic_thread_fence(std::memory_order_release); // "busy" is visible before the new words
+
+      for (int w = 0; w < (1 << Cache_Shift) / 32; w++) {
+
+         uint64 word = 0;
+
+         for (int j = 0; j < 32; j++) {
+            Index k = Index(w * 32 + j);
+            if (k < size) word |= uint64(value[k]) << (j * 2);
+         }
+
+         slot.value[w].store(word, std::memory_order_relaxed);
+      }
+
+      slot.key.store(key, std::memory_order_release);
+   }
+
+   return value[i];
+}
+
+static int load_16(const uint8 * p) { // little endian, unaligned
+   return p[0] | p[1] << 8;
+}
+
 } // namespace bb
 
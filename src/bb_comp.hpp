@@ -10,31 +10,82 @@
 #include "bb_index.hpp"
 #include "common.hpp"
 #include "libmy.hpp"
+#include "util.hpp"
 
 namespace bb {
 
 // types
 
+enum Format : int { Format_RLE, Format_Block }; // on-disk formats, detected when loading
+
 class Index_ { // "Index" is already taken
 
 private:
 
+   struct Stride { // run containing position i << m_shift, packed into 64 bits
+      uint64 byte : 40; // up to 1 TiB files
+      uint64 skip : 24; // positions of that run before it (< longest run)
+   };
+
+   Format m_format;
    Index m_size;
-   std::vector<uint8> m_table;
-   std::vector<Index> m_index;
+   File_Map m_file;
+   const uint8 * m_table;
+
+   std::vector<Stride> m_index;      // RLE format, while building
+   std::vector<Index> m_index_entry; // RLE format, while building
+   File_Map m_index_file;            // RLE format, sidecar
+   const Stride * m_stride;          // either of them
+   const Index * m_entry;            // position of the code at byte e << Entry_Shift, for long strides
+   Index m_stride_size;
+   Index m_entry_size;
+   int m_shift;
+
+   const uint64 * m_block; // block format (directory)
+   int m_block_shift;
 
 public:
 
-   void load (const std::string & file_name, Index size);
+   void load       (const std::string & file_name, Index size);
+   bool save_block (const std::string & file_name) const; // block format
+
+   void decode (Index pos, Index size, uint8 * out) const; // sequential
+
+   Format format     ()          const { return m_format; }
+   Index  size       ()          const { return m_size; }
+   int64  file_size   ()          const { return m_file.size(); }
+   int64  memory_size () const; // index tables
+   int    operator [] (Index pos) const;
+   int    probe       (Index pos) const; // bypasses the block cache
+
+private:
+
+   bool load_block (const std::string & file_name);
+
+   void make_index (const std::string & file_name);
+   bool load_index (const std::string & file_name);
+   void save_index (const std::string & file_name) const;
+
+   void find_run (Index pos, Index & byte, Index & skip) const;
 
-   Index size        ()          const { return m_size; }
-   int   operator [] (Index pos) const;
+   int probe_rle   (Index pos) const;
+   int probe_block (Index pos) const;
 };
 
 // functions
 
 void comp_init ();
 
+bool comp_save (const std::string & file_name, const uint8 * value, Index size); // RLE format (generator)
+
+bool comp_has_avx2 (); // CPU support, detected at start-up
+bool comp_avx2     (); // AVX2 run decoding in use
+void comp_set_avx2 (bool avx2);
+
+bool comp_cache       (); // shared cache of decoded blocks in use
+void comp_set_cache   (int size); // KiB, 0 = none
+void comp_cache_stats (int64 & hit, int64 & miss); // totals of the calling thread
+
 } // namespace bb
 
 #endif // !defined BB_COMP_HPP
@@ -0,0 +1,559 @@
+
+// includes
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bb_base.hpp"
+#include "bb_comp.hpp"
+#include "bb_gen.hpp"
+#include "bb_index.hpp"
+#include "bit.hpp"
+#include "common.hpp"
+#include "gen.hpp"
+#include "libmy.hpp"
+#include "list.hpp"
+#include "move.hpp"
+#include "pos.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace bb {
+
+// constants
+
+const Index Chunk_Size {1 << 14}; // positions per work unit
+
+const uint8  Count_Draw {0x80};   // flag in the successor count: a draw is available
+const uint16 Pass_None  {0xFFFF}; // not a win or loss (yet)
+
+// types
+
+struct Table { // one material ID being generated
+
+   ID id;
+   Index size;
+
+   std::unique_ptr<std::atomic<uint8>[]>  value;
+   std::unique_ptr<std::atomic<uint8>[]>  count; // unknown successors in the group + Count_Draw
+   std::unique_ptr<std::atomic<uint16>[]> pass;  // when the position was resolved to a win or loss
+
+   int64 wdl[Unknown]; // statistics, indexed by value
+};
+
+class Group { // an ID and its colour mirror, which depend on each other
+
+private:
+
+   std::vector<Table> m_table;
+   int m_threads;
+   int m_pass {0};
+
+public:
+
+   Group (ID id, int threads);
+
+   void run ();
+   void save () const;
+
+   int64 size   () const;
+   int64 memory () const { return size() * 4; } // bytes
+   int   passes () const { return m_pass; }
+
+   const std::vector<Table> & tables () const { return m_table; }
+
+private:
+
+   Table & table (ID id);
+   bool has (ID id) const;
+
+   void init_pos (Table & t, Index i);
+   int64 retro   (const Table & t, Index i); // number of predecessors resolved to a win or loss
+
+   int64 update (const Pos & pos, int value);
+};
+
+// prototypes
+
+template <typename F> static void parallel_for (int threads, Index size, F f);
+
+static bool id_is_gen (ID id, int size);
+static int  pos_value (const Pos & pos);
+static void make_path (const std::string & file_name);
+
+// functions
+
+void gen(int size, int threads) {
+
+   if (var::Variant == var::Frisian) {
+      std::cerr << "bitbase generation is not available for Frisian draughts" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   assert(threads > 0);
+
+   std::vector<ID> ids;
+
+   for (int i = 0; i < ID_Size; i++) {
+      ID id = ID(i);
+      if (id_is_gen(id, size)) ids.push_back(id);
+   }
+
+   std::stable_sort(ids.begin(), ids.end(), [](ID i0, ID i1) { // captures and promotions lead to earlier IDs
+      int m0 = id_wm(i0) + id_bm(i0);
+      int m1 = id_wm(i1) + id_bm(i1);
+      return id_size(i0) < id_size(i1) || (id_size(i0) == id_size(i1) && m0 < m1);
+   });
+
+   std::vector<bool> done(ID_Size, false);
+
+   int64 positions = 0;
+   int64 memory = 0;
+
+   Timer timer;
+   timer.start();
+
+   for (ID id : ids) {
+
+      if (done[id]) continue;
+
+      ID mirror = id_make(id_bm(id), id_wm(id), id_bk(id), id_wk(id));
+
+      done[id] = true;
+      done[mirror] = true;
+
+      if (std::ifstream(id_file(id)) && std::ifstream(id_file(mirror))) { // already there
+         load(id);
+         if (mirror != id) load(mirror);
+         continue;
+      }
+
+      Timer group_timer;
+      group_timer.start();
+
+      Group group(id, threads);
+      group.run();
+      group.save();
+
+      for (const Table & t : group.tables()) {
+
+         load(t.id); // probed by later IDs
+
+         double n = double(t.wdl[Win] + t.wdl[Draw] + t.wdl[Loss]) / 100.0; // unused indices are not counted
+         std::printf("%s %12lld positions  W %5.1f%%  D %5.1f%%  L %5.1f%%\n", id_name(t.id).c_str(), (long long)t.size, double(t.wdl[Win]) / n, double(t.wdl[Draw]) / n, double(t.wdl[Loss]) / n);
+      }
+
+      double time = group_timer.elapsed();
+      std::printf("     %d passes, %.3f s, %.2f Mpos/s\n", group.passes(), time, double(group.size()) / std::max(time, 1E-6) / 1E6);
+      std::fflush(stdout);
+
+      positions += group.size();
+      memory = std::max(memory, group.memory());
+   }
+
+   double time = timer.elapsed();
+
+   std::printf("\n");
+   std::printf("positions   : %lld\n", (long long)positions);
+   std::printf("time        : %.3f s\n", time);
+   std::printf("speed       : %.2f Mpos/s\n", double(positions) / std::max(time, 1E-6) / 1E6);
+   std::printf("peak tables : %.1f MiB\n", double(memory) / double(1 << 20));
+   std::printf("peak memory : %.1f MiB\n", double(peak_memory()) / double(1 << 20));
+}
+
+bool verify(int threads) {
+
+   if (var::Variant == var::Frisian) {
+      std::cerr << "bitbase verification is not available for Frisian draughts" << std::endl;
+      std::exit(EXIT_FAILURE);
+   }
+
+   assert(threads > 0);
+
+   int64 positions = 0;
+   std::vector<ID> bad;
+
+   Timer timer;
+   timer.start();
+
+   for (int i = 0; i < ID_Size; i++) {
+
+      ID id = ID(i);
+      if (!id_is_load(id)) continue;
+
+      std::atomic<int64> checked {0};
+      std::atomic<int64> errors {0};
+      std::atomic<Index> first {index_size(id)};
+
+      parallel_for(threads, index_size(id), [&](Index begin, Index end) {
+
+         int64 n = 0;
+         int64 e = 0;
+
+         for (Index j = begin; j < end; j++) {
+
+            Pos pos;
+            if (!index_pos(pos, id, j) || pos::is_capture(pos)) continue; // never probed
+
+            n++;
+
+            if (probe_index(id, j) != pos_value(pos)) {
+
+               e++;
+
+               Index index = first;
+               while (j < index && !first.compare_exchange_weak(index, j)) {}
+            }
+         }
+
+         checked += n;
+         errors += e;
+      });
+
+      positions += checked;
+
+      if (errors != 0) {
+         std::printf("%s %12lld positions, %lld mismatches (first at index %lld)\n", id_name(id).c_str(), (long long)checked, (long long)errors, (long long)first);
+         bad.push_back(id);
+      } else {
+         std::printf("%s %12lld positions, OK\n", id_name(id).c_str(), (long long)checked);
+      }
+
+      std::fflush(stdout);
+   }
+
+   double time = timer.elapsed();
+
+   std::printf("\n");
+   std::printf("positions : %lld\n", (long long)positions);
+   std::printf("time      : %.3f s\n", time);
+   std::printf("speed     : %.2f Mpos/s\n", double(positions) / std::max(time, 1E-6) / 1E6);
+   std::printf("mismatch  :");
+   for (ID id : bad) std::printf(" %s", id_name(id).c_str());
+   std::printf("%s\n", bad.empty() ? " none" : "");
+
+   return bad.empty();
+}
+
+static int pos_value(const Pos & pos) { // minimax over the successors, for a quiet position
+
+   assert(!pos::is_capture(pos));
+
+   if (pos::is_end(pos)) return value_from_nega(pos::result(pos, pos.turn()));
+
+   int node = Loss;
+
+   List list;
+   gen_moves(list, pos);
+
+   for (Move mv : list) {
+      node = value_update(node, probe(pos.succ(mv)));
+      if (node == Win) break;
+   }
+
+   return node;
+}
+
+static bool id_is_gen(ID id, int size) {
+   return !id_is_illegal(id) && !id_is_end(id) && id_size(id) <= size;
+}
+
+static void make_path(const std::string & file_name) { // creates the parent directories
+
+   for (std::size_t i = file_name.find('/'); i != std::string::npos; i = file_name.find('/', i + 1)) {
+
+      std::string dir_name = file_name.substr(0, i);
+
+      if (!make_dir(dir_name)) {
+         std::cerr << "unable to create directory \"" << dir_name << "\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+   }
+}
+
+template <typename F> static void parallel_for(int threads, Index size, F f) { // f(begin, end) on chunks
+
+   std::atomic<Index> next {0};
+
+   auto work = [&]() {
+      for (Index begin = next.fetch_add(Chunk_Size); begin < size; begin = next.fetch_add(Chunk_Size)) {
+         f(begin, std::min(size - begin, Chunk_Size) + begin);
+      }
+   };
+
+   threads = int(std::min(Index(threads), (size + Chunk_Size - 1) / Chunk_Size));
+
+   std::vector<std::thread> worker;
+
+   for (int i = 1; i < threads; i++) {
+      worker.emplace_back(work);
+   }
+
+   work();
+
+   for (std::thread & thread : worker) {
+      thread.join();
+   }
+}
+
+Group::Group(ID id, int threads) {
+
+   ID mirror = id_make(id_bm(id), id_wm(id), id_bk(id), id_wk(id));
+
+   m_table.resize((mirror == id) ? 1 : 2);
+   m_threads = threads;
+
+   for (int i = 0; i < int(m_table.size()); i++) {
+
+      Table & t = m_table[i];
+
+      t.id = (i == 0) ? id : mirror;
+      t.size = index_size(t.id);
+
+      t.value.reset(new std::atomic<uint8>[t.size]);
+      t.count.reset(new std::atomic<uint8>[t.size]);
+      t.pass.reset(new std::atomic<uint16>[t.size]);
+
+      std::fill(t.wdl, t.wdl + Unknown, 0);
+   }
+}
+
+void Group::run() {
+
+   // positions with a capture, no move, or only moves out of the group
+
+   for (Table & t : m_table) {
+      parallel_for(m_threads, t.size, [&](Index begin, Index end) {
+         for (Index i = begin; i < end; i++) init_pos(t, i);
+      });
+   }
+
+   // propagate wins and losses, one pass per ply
+
+   for (m_pass = 0; m_pass < Pass_None - 1; m_pass++) {
+
+      std::atomic<int64> resolved {0};
+
+      for (const Table & t : m_table) {
+         parallel_for(m_threads, t.size, [&](Index begin, Index end) {
+            int64 n = 0;
+            for (Index i = begin; i < end; i++) {
+               if (t.pass[i].load(std::memory_order_relaxed) == m_pass) n += retro(t, i);
+            }
+            resolved += n;
+         });
+      }
+
+      if (resolved == 0) break;
+   }
+
+   // remaining positions are draws (no progress possible for either side)
+
+   for (Table & t : m_table) {
+
+      std::atomic<int64> wdl[Unknown] {};
+
+      parallel_for(m_threads, t.size, [&](Index begin, Index end) {
+
+         int64 n[Unknown] {};
+
+         for (Index i = begin; i < end; i++) {
+
+            int value = t.value[i].load(std::memory_order_relaxed);
+
+            if (value == Unknown) {
+               if (t.count[i].load(std::memory_order_relaxed) == 0) continue; // unused index
+               value = Draw;
+               t.value[i].store(uint8(value), std::memory_order_relaxed);
+            }
+
+            n[value]++;
+         }
+
+         for (int v = 0; v < Unknown; v++) wdl[v] += n[v];
+      });
+
+      for (int v = 0; v < Unknown; v++) t.wdl[v] = wdl[v];
+   }
+}
+
+void Group::save() const {
+
+   for (const Table & t : m_table) {
+
+      std::string file_name = id_file(t.id);
+      make_path(file_name);
+
+      std::vector<uint8> value(t.size);
+
+      for (Index i = 0; i < t.size; i++) {
+         value[i] = t.value[i].load(std::memory_order_relaxed);
+         if (value[i] == Unknown) value[i] = (i == 0) ? uint8(Draw) : value[i - 1]; // unused index, extends the run
+      }
+
+      if (!comp_save(file_name, value.data(), t.size)) {
+         std::cerr << "unable to write file \"" << file_name << "\"" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+   }
+}
+
+int64 Group::size() const {
+
+   int64 size = 0;
+
+   for (const Table & t : m_table) {
+      size += t.size;
+   }
+
+   return size;
+}
+
+Table & Group::table(ID id) {
+   assert(has(id));
+   return (m_table[0].id == id) ? m_table[0] : m_table[1];
+}
+
+bool Group::has(ID id) const {
+
+   for (const Table & t : m_table) {
+      if (t.id == id) return true;
+   }
+
+   return false;
+}
+
+void Group::init_pos(Table & t, Index i) {
+
+   Pos pos;
+
+   int value = Unknown;
+   int count = 0;
+
+   if (!index_pos(pos, t.id, i)) { // unused, left unknown with no successors
+
+      ;
+
+   } else if (pos::is_end(pos)) {
+
+      value = value_from_nega(pos::result(pos, pos.turn()));
+
+   } else if (pos::is_capture(pos)) { // successors have fewer pieces
+
+      value = probe(pos);
+
+   } else {
+
+      int node = Loss;
+
+      List list;
+      gen_moves(list, pos);
+
+      for (Move mv : list) {
+
+         Pos succ = pos.succ(mv);
+
+         if (has(pos_id(succ))) { // same material, resolved later
+            count++;
+         } else { // promotion
+            node = value_update(node, probe(succ));
+            if (node == Win) break;
+         }
+      }
+
+      if (node == Win || count == 0) {
+         value = node;
+      } else if (node == Draw) {
+         count |= Count_Draw;
+      }
+   }
+
+   assert(count < 256);
+
+   t.value[i].store(uint8(value), std::memory_order_relaxed);
+   t.count[i].store(uint8(count), std::memory_order_relaxed);
+   t.pass[i].store((value == Win || value == Loss) ? 0 : Pass_None, std::memory_order_relaxed);
+}
+
+int64 Group::retro(const Table & t, Index i) {
+
+   int value = t.value[i].load(std::memory_order_relaxed);
+   assert(value == Win || value == Loss);
+
+   Pos pos; // White to move => Black just played
+   index_pos(pos, t.id, i);
+
+   Bit wm = pos.wm();
+   Bit bm = pos.bm();
+   Bit wk = pos.wk();
+   Bit bk = pos.bk();
+
+   Bit be = pos.empty();
+
+   int64 n = 0;
+
+   for (Square to : bm & (be << I1)) {
+      n += update(Pos(Black, wm, bm ^ bit::bit(to) ^ bit::bit(Square(to - I1)), wk, bk), value);
+   }
+
+   for (Square to : bm & (be << J1)) {
+      n += update(Pos(Black, wm, bm ^ bit::bit(to) ^ bit::bit(Square(to - J1)), wk, bk), value);
+   }
+
+   for (Square to : bk) {
+      for (Square from : bit::king_moves(to, be) & be) {
+         n += update(Pos(Black, wm, bm, wk, bk ^ bit::bit(to) ^ bit::bit(from)), value);
+      }
+   }
+
+   return n;
+}
+
+int64 Group::update(const Pos & pos, int value) { // "value" is for the opponent
+
+   if (pos::is_capture(pos)) return 0; // illegal move
+
+   ID id = pos_id(pos);
+   Table & t = table(id);
+   Index i = pos_index(id, pos);
+
+   if (t.value[i].load(std::memory_order_relaxed) != Unknown) return 0;
+
+   uint8 unknown = Unknown;
+
+   if (value == Loss) {
+
+      if (t.value[i].compare_exchange_strong(unknown, Win, std::memory_order_relaxed)) {
+         t.pass[i].store(uint16(m_pass + 1), std::memory_order_relaxed);
+         return 1;
+      }
+
+   } else { // win for the opponent: one fewer escape
+
+      uint8 count = t.count[i].fetch_sub(1, std::memory_order_relaxed);
+      assert((count & ~Count_Draw) != 0);
+
+      if ((count & ~Count_Draw) == 1) { // last one
+
+         uint8 node = ((count & Count_Draw) != 0) ? Draw : Loss;
+
+         if (t.value[i].compare_exchange_strong(unknown, node, std::memory_order_relaxed) && node == Loss) {
+            t.pass[i].store(uint16(m_pass + 1), std::memory_order_relaxed);
+            return 1;
+         }
+      }
+   }
+
+   return 0;
+}
+
+} // namespace bb
+
@@ -0,0 +1,20 @@
+
+#ifndef BB_GEN_HPP
+#define BB_GEN_HPP
+
+// includes
+
+#include "common.hpp"
+#include "libmy.hpp"
+
+namespace bb {
+
+// functions
+
+void gen    (int size, int threads); // retrograde analysis of missing tables up to "size" pieces
+bool verify (int threads); // loaded tables against their successors
+
+} // namespace bb
+
+#endif // !defined BB_GEN_HPP
+
@@ -41,6 +41,9 @@ static Tuple tuple_index_rev (Bit pieces, Bit squares, int p, int n);
 
 static Tuple tuple_size (int p, int n);
 
+static Bit tuple_pieces     (Tuple index, Bit squares, int p, int n);
+static Bit tuple_pieces_rev (Tuple index, Bit squares, int p, int n);
+
 static int wolf_index_white (ID id, const Pos & pos, bool rev = false);
 static int wolf_index_black (ID id, const Pos & pos, bool rev = false);
 
@@ -50,6 +53,9 @@ static int wolf_size_black (ID id);
 static int bit_index     (Bit b, Square sq);
 static int bit_index_rev (Bit b, Square sq);
 
+static Square bit_square     (Bit b, int index);
+static Square bit_square_rev (Bit b, int index);
+
 // functions
 
 void index_init() {
@@ -75,7 +81,8 @@ void index_init() {
 }
 
 ID id_make(int wm, int bm, int wk, int bk) {
-   assert(wm + bm + wk + bk < 8);
+   assert(wm < 8 && bm < 8 && wk < 8 && bk < 8);
+   assert(wm + bm + wk + bk <= Size_Max);
    return ID((wm << 9) | (bm << 6) | (wk << 3) | (bk << 0));
 }
 
@@ -207,6 +214,41 @@ static Index pos_index_btm(ID id, const Pos & pos) {
    return index;
 }
 
+bool index_pos(Pos & pos, ID id, Index index) { // inverse of "pos_index_wtm", false if men overlap (unused index)
+
+   assert(var::Variant != var::Frisian); // no wolves
+   assert(index < index_size(id));
+
+   int nwm = id_wm(id);
+   int nbm = id_bm(id);
+   int nwk = id_wk(id);
+   int nbk = id_bk(id);
+
+   Tuple size_bm = tuple_size(nbm, Man_Squares);
+   Tuple size_wk = tuple_size(nwk, King_Squares - nwm - nbm);
+   Tuple size_bk = tuple_size(nbk, King_Squares - nwm - nbm - nwk);
+
+   Tuple index_bk = Tuple(index % size_bk);
+   index /= size_bk;
+   Tuple index_wk = Tuple(index % size_wk);
+   index /= size_wk;
+   Tuple index_bm = Tuple(index % size_bm);
+   index /= size_bm;
+   Tuple index_wm = Tuple(index);
+   assert(index_wm < tuple_size(nwm, Man_Squares));
+
+   Bit wm = tuple_pieces_rev(index_wm, bit::WM_Squares, nwm, Man_Squares);
+   Bit bm = tuple_pieces(index_bm, bit::BM_Squares, nbm, Man_Squares);
+
+   if ((wm & bm) != 0) return false;
+
+   Bit wk = tuple_pieces_rev(index_wk, bit::Squares ^ wm ^ bm, nwk, King_Squares - nwm - nbm);
+   Bit bk = tuple_pieces(index_bk, bit::Squares ^ wm ^ bm ^ wk, nbk, King_Squares - nwm - nbm - nwk);
+
+   pos = Pos(White, wm, bm, wk, bk);
+   return true;
+}
+
 Index index_size(ID id) {
 
    int nwm = id_wm(id);
@@ -293,6 +335,50 @@ static Tuple tuple_size(int p, int n) {
    return Tuple_Size[p][n];
 }
 
+static Bit tuple_pieces(Tuple index, Bit squares, int p, int n) { // inverse of "tuple_index"
+
+   assert(p >= 0 && p <= P_Max);
+   assert(n >= p && n <= N_Max);
+   assert(index < tuple_size(p, n));
+
+   Bit pieces {};
+
+   for (int i = p; i > 0; i--) { // largest position first
+
+      int pos = i - 1;
+      while (pos + 1 < n && tuple_size(i, pos + 1) <= index) pos++;
+
+      index -= tuple_size(i, pos);
+      pieces = bit::add(pieces, bit_square(squares, pos));
+      n = pos;
+   }
+
+   assert(index == 0);
+   return pieces;
+}
+
+static Bit tuple_pieces_rev(Tuple index, Bit squares, int p, int n) { // inverse of "tuple_index_rev"
+
+   assert(p >= 0 && p <= P_Max);
+   assert(n >= p && n <= N_Max);
+   assert(index < tuple_size(p, n));
+
+   Bit pieces {};
+
+   for (int i = p; i > 0; i--) {
+
+      int pos = i - 1;
+      while (pos + 1 < n && tuple_size(i, pos + 1) <= index) pos++;
+
+      index -= tuple_size(i, pos);
+      pieces = bit::add(pieces, bit_square_rev(squares, pos));
+      n = pos;
+   }
+
+   assert(index == 0);
+   return pieces;
+}
+
 static int wolf_index_white(ID id, const Pos & pos, bool rev) {
 
    if (var::Variant == var::Frisian) {
@@ -365,5 +451,20 @@ static int bit_index_rev(Bit b, Square sq) {
    return bit::count(b & (0 - ml::bit(sq + 1)));
 }
 
+static Square bit_square(Bit b, int index) { // inverse of "bit_index"
+
+   assert(index >= 0 && index < bit::count(b));
+
+   for (int i = 0; i < index; i++) {
+      b = bit::rest(b);
+   }
+
+   return bit::first(b);
+}
+
+static Square bit_square_rev(Bit b, int index) { // inverse of "bit_index_rev"
+   return bit_square(b, bit::count(b) - 1 - index);
+}
+
 } // namespace bb
 
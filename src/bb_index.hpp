@@ -15,11 +15,12 @@ namespace bb {
 
 // constants
 
-const int ID_Size {1 << 12};
+const int ID_Size  {1 << 12};
+const int Size_Max {8}; // pieces
 
 // types
 
-using Index = uint32; // enough for 6 pieces (7 for BT variant)
+using Index = uint64; // 8 pieces need more than 32 bits
 
 enum ID : int;
 
@@ -44,6 +45,7 @@ std::string id_name (ID id);
 ID pos_id (const Pos & pos);
 
 Index pos_index (ID id, const Pos & pos);
+bool  index_pos (Pos & pos, ID id, Index index); // White to move, not for Frisian
 
 Index index_size (ID id);
 
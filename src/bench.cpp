@@ -0,0 +1,386 @@
+
+// includes
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bb_base.hpp"
+#include "bb_comp.hpp"
+#include "bb_index.hpp"
+#include "bench.hpp"
+#include "bit.hpp"
+#include "common.hpp"
+#include "eval.hpp"
+#include "fen.hpp"
+#include "hub.hpp"
+#include "libmy.hpp"
+#include "pos.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include "util.hpp"
+#include "var.hpp"
+
+namespace bench {
+
+// types
+
+struct Position {
+   const char * variant;
+   const char * fen;
+};
+
+struct Result {
+   int64 node {0};
+   double time {0.0};
+   Thread_Stats stats;
+};
+
+// constants
+
+const int Clock_Reads {10000000};
+
+const Position Suite[] { // grouped by variant
+
+   {"normal", "W:W31-50:B1-20"},
+   {"normal", "B:W28,31,33-50:B1-20"},
+   {"normal", "W:W27,28,31-34,36-43,45,47,48:B3,4,6-9,11-14,16-19,22,23"},
+   {"normal", "W:W24,27,28,30,32-35,37-40,42-44,48:B2,3,6-9,11-14,16-19,21,23"},
+   {"normal", "B:W25,29,30,33-35,38,40,42,44,45,47:B6,9,11-13,15,16,18,20,21,24"},
+   {"normal", "W:W26,32,33,37,38,43,48:B8,12,13,17,18,22,24"},
+   {"normal", "W:W28,33,38,39:B13,17,18,22"},
+   {"normal", "B:WK3,37,42:BK46,16,19"},
+
+   {"killer", "W:W31-50:B1-20"},
+   {"killer", "W:W27,28,31-34,36-43,45,47,48:B3,4,6-9,11-14,16-19,22,23"},
+   {"killer", "W:WK10,33,38,42:BK45,13,18,24"},
+
+   {"bt", "W:W31-50:B1-20"},
+   {"bt", "B:W24,27,28,30,32-35,37-40,42-44,48:B2,3,6-9,11-14,16-19,21,23"},
+   {"bt", "W:W26,32,33,37,38,43,48:B8,12,13,17,18,22,24"},
+
+   {"frisian", "W:W31-50:B1-20"},
+   {"frisian", "W:W27,28,31-34,36-43,45,47,48:B3,4,6-9,11-14,16-19,22,23"},
+   {"frisian", "W:WK48,27,33,38,39:BK3,12,13,18,19"},
+
+   {"losing", "W:W31-50:B1-20"},
+   {"losing", "W:W27,28,31-34,36-43,45,47,48:B3,4,6-9,11-14,16-19,22,23"},
+   {"losing", "W:W32,37,38,42,43,47:B4,8,9,13,14,19"},
+};
+
+// prototypes
+
+static Result run_suite (Depth depth, int64 nodes, int threads, Output_Type output);
+
+static bool set_variant  (const std::string & variant);
+static bool has_eval     (const std::string & variant);
+static void disp_skipped ();
+
+template <typename F> static void clock_read (const char * name, F read);
+
+// functions
+
+void run(Depth depth, int64 nodes, Output_Type output) {
+
+   Result res = run_suite(depth, nodes, 1, output);
+
+   double nps = (res.time < 1E-3) ? 0.0 : double(res.node) / res.time;
+
+   if (output == Output_Hub) {
+
+      std::string line = "bench";
+      hub::add_pair(line, "nodes", std::to_string(res.node));
+      hub::add_pair(line, "time", ml::ftos(res.time, 3));
+      hub::add_pair(line, "nps", ml::ftos(nps / 1E6, 1));
+      hub::add_pair(line, "signature", std::to_string(res.node));
+      hub::write(line);
+
+   } else {
+
+      std::printf("\n");
+      std::printf("nodes     : %lld\n", (long long)res.node);
+      std::printf("time      : %.3f s\n", res.time);
+      std::printf("nps       : %.1f M\n", nps / 1E6);
+      std::printf("signature : %lld\n", (long long)res.node);
+   }
+}
+
+void smp(int threads, Depth depth) {
+
+   Result base;
+
+   disp_skipped();
+
+   std::printf("\n");
+   std::printf("threads     time  speedup    nps  nps-speedup  overhead    splits     joins      cuts   idle\n");
+
+   for (int n = 1; n <= threads; n = (n == threads) ? n + 1 : std::min(n * 2, threads)) {
+
+      Result res = run_suite(depth, int64(1E12), n, Output_None);
+      if (n == 1) base = res;
+
+      double nps      = (res.time  < 1E-3) ? 0.0 : double(res.node)  / res.time;
+      double nps_base = (base.time < 1E-3) ? 0.0 : double(base.node) / base.time;
+
+      double speedup     = (res.time < 1E-3) ? 0.0 : base.time / res.time;
+      double nps_speedup = (nps_base == 0.0) ? 0.0 : nps / nps_base;
+      double overhead    = (base.node == 0)  ? 0.0 : double(res.node) / double(base.node);
+      double idle        = (res.time < 1E-3) ? 0.0 : res.stats.idle / double(n) / res.time; // average per thread
+
+      std::printf("%7d %8.3f %8.2f %6.2f %12.2f %9.2f %9lld %9lld %9lld %5.1f%%\n",
+                  n, res.time, speedup, nps / 1E6, nps_speedup, overhead,
+                  (long long)res.stats.splits, (long long)res.stats.joins, (long long)res.stats.cuts, idle * 100.0);
+      std::fflush(stdout);
+   }
+}
+
+void root_split(int threads, Depth depth) {
+
+   std::string root_split = var::get("root-split");
+
+   disp_skipped();
+
+   std::printf("\n");
+   std::printf("mode           time  speedup     nodes  overhead    nps\n");
+
+   Result base;
+
+   for (int mode = 0; mode < 2; mode++) {
+
+      var::set("root-split", (mode == 0) ? "false" : "true");
+
+      Result res = run_suite(depth, int64(1E12), threads, Output_None);
+      if (mode == 0) base = res;
+
+      double nps      = (res.time < 1E-3) ? 0.0 : double(res.node) / res.time;
+      double speedup  = (res.time < 1E-3) ? 0.0 : base.time / res.time;
+      double overhead = (base.node == 0)  ? 0.0 : double(res.node) / double(base.node);
+
+      std::printf("%-10s %8.3f %8.2f %9lld %9.2f %6.2f\n", (mode == 0) ? "split" : "root-split", res.time, speedup, (long long)res.node, overhead, nps / 1E6);
+      std::fflush(stdout);
+   }
+
+   var::set("root-split", root_split);
+   var::update();
+}
+
+static Result run_suite(Depth depth, int64 nodes, int threads, Output_Type output) {
+
+   // deterministic settings (restored afterwards)
+
+   std::string variant = var::get("variant");
+   std::string threads_ = var::get("threads");
+   std::string bb_size = var::get("bb-size");
+
+   var::set("threads", std::to_string(threads));
+   var::set("bb-size", "0"); // bitbase files may be missing
+   var::update();
+
+   Search_Input si;
+   si.move = false;
+   si.book = false;
+   si.depth = depth;
+   si.nodes = nodes;
+
+   Result res;
+
+   std::string current = variant;
+   bool skip = false;
+
+   for (int i = 0; i < int(sizeof(Suite) / sizeof(Suite[0])); i++) {
+
+      const Position & bp = Suite[i];
+
+      if (bp.variant != current) {
+         current = bp.variant;
+         skip = !set_variant(current);
+         if (skip && output == Output_Terminal) std::printf("variant %s skipped (no evaluation file)\n", current.c_str());
+      }
+
+      if (skip) continue;
+
+      Pos pos = pos_from_fen(bp.fen);
+
+      G_TT.clear();
+
+      Search_Output so;
+      search(so, Node(pos), si);
+
+      res.node += so.node;
+      res.time += so.time();
+
+      for (const Thread_Stats & ts : so.thread) {
+         res.stats.splits += ts.splits;
+         res.stats.cuts   += ts.cuts;
+         res.stats.tries  += ts.tries;
+         res.stats.joins  += ts.joins;
+         res.stats.idle   += ts.idle;
+      }
+
+      if (output == Output_Hub) {
+
+         std::string line = "info";
+         hub::add_pair(line, "bench", std::to_string(i + 1));
+         hub::add_pair(line, "variant", bp.variant);
+         hub::add_pair(line, "nodes", std::to_string(so.node));
+         hub::add_pair(line, "time", ml::ftos(so.time(), 3));
+         hub::write(line);
+
+      } else if (output == Output_Terminal) {
+
+         std::printf("%2d %-8s %-72s %10lld nodes %6.3f s\n", i + 1, bp.variant, bp.fen, (long long)so.node, so.time());
+      }
+   }
+
+   // restore
+
+   var::set("threads", threads_);
+   var::set("bb-size", bb_size);
+   if (current != variant) set_variant(variant);
+   var::update();
+
+   return res;
+}
+
+static bool set_variant(const std::string & variant) {
+
+   if (!has_eval(variant)) return false;
+
+   bit::init(); // depends on the variant
+   eval_init();
+
+   return true;
+}
+
+static bool has_eval(const std::string & variant) { // also selects the variant
+
+   var::set("variant", variant);
+   var::update();
+
+   std::ifstream file(std::string("data/eval") + var::variant_name());
+   return bool(file);
+}
+
+static void disp_skipped() { // once per table, not for every run of the suite
+
+   std::string variant = var::get("variant");
+   std::string current;
+
+   for (const Position & bp : Suite) {
+
+      if (bp.variant == current) continue;
+      current = bp.variant;
+
+      if (!has_eval(current)) std::printf("variant %s skipped (no evaluation file)\n", current.c_str());
+   }
+
+   var::set("variant", variant);
+   var::update();
+}
+
+void clock() {
+
+   std::printf("tick source: %s (%.3f ns/tick)\n", tick_is_tsc() ? "TSC" : "steady_clock", tick_time(1000000) * 1E3);
+   std::printf("\n");
+
+   clock_read("system_clock", [] { return uint64(std::chrono::system_clock::now().time_since_epoch().count()); });
+   clock_read("steady_clock", [] { return uint64(std::chrono::steady_clock::now().time_since_epoch().count()); });
+   clock_read("tick",         [] { return tick(); });
+}
+
+void bitbase(int64 probes) {
+
+   if (!var::BB) {
+      std::printf("no bitbases (bb-size = 0)\n");
+      return;
+   }
+
+   bool avx2 = bb::comp_avx2();
+   int passes = bb::comp_has_avx2() ? 2 : 1; // scalar, then AVX2
+
+   std::printf("run decoding: %s\n", (passes == 2) ? "scalar and AVX2" : "scalar (no AVX2)");
+   std::printf("\n");
+
+   std::mt19937_64 gen; // fixed seed
+   std::vector<bb::Index> index(probes);
+
+   int64 probe_sum = 0;
+   double time_sum[2] {0.0, 0.0};
+   int value_sum = 0; // keep the probes alive
+
+   for (int i = 0; i < bb::ID_Size; i++) {
+
+      bb::ID id = bb::ID(i);
+      if (!bb::id_is_load(id)) continue;
+
+      bb::Index size = bb::index_size(id);
+
+      for (bb::Index & ix : index) {
+         ix = bb::Index(gen() % size);
+      }
+
+      for (bb::Index ix : index) { // warm-up (page faults)
+         value_sum += bb::probe_index(id, ix);
+      }
+
+      std::printf("%s %12llu positions:", bb::id_name(id).c_str(), (unsigned long long)size);
+
+      for (int pass = 0; pass < passes; pass++) {
+
+         bb::comp_set_avx2(pass != 0);
+
+         Timer timer;
+         timer.start();
+
+         for (bb::Index ix : index) {
+            value_sum += bb::probe_index(id, ix);
+         }
+
+         timer.stop();
+
+         double time = timer.elapsed();
+         std::printf(" %6.1f ns/probe %7.2f Mprobes/s", time * 1E9 / double(probes), double(probes) / time / 1E6);
+
+         time_sum[pass] += time;
+      }
+
+      std::printf("\n");
+
+      probe_sum += probes;
+   }
+
+   bb::comp_set_avx2(avx2);
+
+   if (probe_sum == 0) return;
+
+   std::printf("\n");
+   std::printf("probes    : %lld\n", (long long)probe_sum);
+   std::printf("scalar    : %.1f ns/probe\n", time_sum[0] * 1E9 / double(probe_sum));
+   if (passes == 2) std::printf("AVX2      : %.1f ns/probe\n", time_sum[1] * 1E9 / double(probe_sum));
+   std::printf("checksum  : %d\n", value_sum & 0xF);
+}
+
+template <typename F>
+static void clock_read(const char * name, F read) {
+
+   uint64 sum = 0; // keep the reads alive
+
+   Timer timer;
+   timer.start();
+
+   for (int i = 0; i < Clock_Reads; i++) {
+      sum += read();
+   }
+
+   timer.stop();
+
+   double time = timer.elapsed();
+   std::printf("%-12s: %6.1f ns/read (%llx)\n", name, time * 1E9 / double(Clock_Reads), (unsigned long long)(sum & 0xF));
+}
+
+} // namespace bench
+
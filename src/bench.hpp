@@ -0,0 +1,28 @@
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+// includes
+
+#include "common.hpp"
+#include "libmy.hpp"
+#include "search.hpp"
+
+namespace bench {
+
+// constants
+
+const Depth Depth_Default {Depth(12)};
+
+// functions
+
+void run        (Depth depth, int64 nodes, Output_Type output);
+void smp        (int threads, Depth depth);
+void root_split (int threads, Depth depth);
+void clock      ();
+void bitbase    (int64 probes); // per material ID
+
+} // namespace bench
+
+#endif // !defined BENCH_HPP
+
@@ -107,7 +107,7 @@ bool probe(const Pos & pos, Score margin, Move & move, Score & score) {
 
    if (list.size() == 0) return false;
 
-   int i = list::pick(list, (var::Variant == var::Frisian) ? 10.0 : 20.0);
+   int i = var::Deterministic ? 0 : list::pick(list, (var::Variant == var::Frisian) ? 10.0 : 20.0); // sorted => 0 is the best move
 
    move = list.move(i);
    score = score::make(list.score(i));
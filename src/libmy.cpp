@@ -30,6 +30,10 @@ void rand_init() {
    gen.seed(std::random_device{}());
 }
 
+void rand_seed(uint64 seed) {
+   gen.seed(seed);
+}
+
 uint64 rand_int_64() {
    return gen();
 }
@@ -76,6 +76,7 @@ private:
 // math
 
 void   rand_init   ();
+void   rand_seed   (uint64 seed);
 uint64 rand_int_64 ();
 bool   rand_bool   (double p);
 
@@ -1,17 +1,22 @@
 
 // includes
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "batch.hpp"
 #include "bb_base.hpp"
 #include "bb_comp.hpp"
+#include "bb_gen.hpp"
 #include "bb_index.hpp"
+#include "bench.hpp"
 #include "bit.hpp"
 #include "book.hpp"
 #include "common.hpp"
@@ -33,6 +38,10 @@
 #include "util.hpp"
 #include "var.hpp"
 
+// constants
+
+const uint64 Deterministic_Seed {0x5CA9}; // "deterministic" mode
+
 // types
 
 class Terminal {
@@ -89,6 +98,7 @@ int main(int argc, char * argv[]) {
    bb::comp_init();
 
    ml::rand_init(); // after hash keys
+   tick_init();
 
    var::load("scan.ini");
 
@@ -112,6 +122,119 @@ int main(int argc, char * argv[]) {
 
       hub_loop();
 
+   } else if (arg == "batch") {
+
+      if (argc < 3) {
+         std::cerr << "usage: " << argv[0] << " batch <file> [depth=...] [nodes=...] [move-time=...] [workers=...]" << std::endl;
+         std::exit(EXIT_FAILURE);
+      }
+
+      Search_Input si;
+      si.move = false;
+      si.book = false;
+      si.depth = Depth(15);
+      si.threads = 1; // one search thread per worker
+
+      int workers = var::Threads;
+
+      for (int i = 3; i < argc; i++) {
+
+         hub::Scanner scan(argv[i]);
+         auto p = scan.get_pair();
+
+         if (false) {
+         } else if (p.name == "depth") {
+            si.depth = Depth(std::stoi(p.value));
+         } else if (p.name == "nodes") {
+            si.nodes = std::stoll(p.value);
+         } else if (p.name == "move-time") {
+            si.depth = Depth_Max;
+            si.time = std::stod(p.value);
+         } else if (p.name == "workers") {
+            workers = std::max(std::stoi(p.value), 1);
+         }
+      }
+
+      init_high();
+
+      batch::run(argv[2], si, workers);
+
+   } else if (arg == "bench") {
+
+      Depth depth = bench::Depth_Default;
+      if (argc > 2) depth = Depth(std::stoi(argv[2]));
+
+      init_high();
+
+      bench::run(depth, int64(1E12), Output_Terminal);
+
+   } else if (arg == "bench-smp") {
+
+      int threads = std::min(int(std::thread::hardware_concurrency()), Thread_Max);
+      if (argc > 2) threads = std::stoi(argv[2]);
+      threads = std::max(std::min(threads, Thread_Max), 1);
+
+      Depth depth = bench::Depth_Default;
+      if (argc > 3) depth = Depth(std::stoi(argv[3]));
+
+      init_high();
+
+      bench::smp(threads, depth);
+
+   } else if (arg == "bench-root") {
+
+      int threads = std::min(int(std::thread::hardware_concurrency()), Thread_Max);
+      if (argc > 2) threads = std::stoi(argv[2]);
+      threads = std::max(std::min(threads, Thread_Max), 2);
+
+      Depth depth = bench::Depth_Default;
+      if (argc > 3) depth = Depth(std::stoi(argv[3]));
+
+      init_high();
+
+      bench::root_split(threads, depth);
+
+   } else if (arg == "bench-clock") {
+
+      bench::clock();
+
+   } else if (arg == "bb-convert") {
+
+      init_high();
+
+      bb::convert();
+
+   } else if (arg == "bb-gen") {
+
+      int size = var::BB_Size;
+      if (argc > 2) size = std::stoi(argv[2]);
+      size = std::min(size, bb::Size_Max);
+
+      int threads = std::max(int(std::thread::hardware_concurrency()), 1);
+      if (argc > 3) threads = std::max(std::stoi(argv[3]), 1);
+
+      bit::init(); // depends on the variant
+
+      bb::gen(size, threads);
+
+   } else if (arg == "bb-verify") {
+
+      int threads = std::max(int(std::thread::hardware_concurrency()), 1);
+      if (argc > 2) threads = std::max(std::stoi(argv[2]), 1);
+
+      init_high();
+
+      if (!bb::verify(threads)) std::exit(EXIT_FAILURE);
+
+   } else if (arg == "bench-bb") {
+
+      int64 probes = int64(1E5);
+      if (argc > 2) probes = std::stoll(argv[2]);
+
+      init_high();
+
+      bench::bitbase(probes);
+
    } else {
 
       std::cerr << "usage: " << argv[0] << " <command>" << std::endl;
@@ -140,11 +263,31 @@ static void hub_loop() {
 
       if (false) {
 
+      } else if (command == "bench") {
+
+         int depth = bench::Depth_Default;
+         int64 nodes = int64(1E12);
+
+         while (!scan.eos()) {
+
+            auto p = scan.get_pair();
+
+            if (false) {
+            } else if (p.name == "depth") {
+               depth = std::stoi(p.value);
+            } else if (p.name == "nodes") {
+               nodes = std::stoll(p.value);
+            }
+         }
+
+         bench::run(Depth(depth), nodes, Output_Hub);
+
       } else if (command == "go") {
 
          bool think = false; // ignored
          bool ponder = false;
          bool analyze = false;
+         int multipv = 1;
 
          while (!scan.eos()) {
 
@@ -157,6 +300,8 @@ static void hub_loop() {
                ponder = true;
             } else if (p.name == "analyze") {
                analyze = true;
+            } else if (p.name == "multipv") {
+               multipv = std::stoi(p.value);
             }
          }
 
@@ -165,6 +310,7 @@ static void hub_loop() {
          si.input = true;
          si.output = Output_Hub;
          si.ponder = ponder;
+         si.multipv = analyze ? multipv : 1;
 
          Search_Output so;
          search(so, game.node(), si);
@@ -203,9 +349,16 @@ static void hub_loop() {
          param_int ("book-ply", 0, 20);
          param_int ("book-margin", 0, 100);
          param_bool("ponder");
-         param_int ("threads", 1, 16);
+         param_int ("threads", 1, Thread_Max);
+         param_bool("root-split");
          param_int ("tt-size", 16, 30);
-         param_int ("bb-size", 0, 7);
+         param_bool("tt-qs");
+         param_bool("killers");
+         param_bool("deterministic");
+         param_int ("bb-size", 0, bb::Size_Max);
+         param_bool("bb-simd");
+         param_int ("bb-cache", 0, 1 << 16);
+         param_int ("bb-hash", 0, 30);
 
          hub::write("wait");
 
@@ -644,6 +797,8 @@ static void init_high() {
 
 static void init_low() {
 
+   if (var::Deterministic) ml::rand_seed(Deterministic_Seed);
+
    bit::init(); // depends on the variant
    if (var::Book) book::init();
    if (var::BB) bb::init();
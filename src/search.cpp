@@ -2,14 +2,18 @@
 // includes
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include "bb_base.hpp"
+#include "bb_comp.hpp"
 #include "book.hpp"
 #include "common.hpp"
 #include "eval.hpp"
@@ -51,16 +55,17 @@ private:
    void init (int moves, double time, double inc, const Pos & pos);
 };
 
-struct Local {
+struct Local { // scalars only, so that split points and helpers copy little
 
 private:
 
    const Node * m_node {nullptr};
+   const List * m_list {nullptr}; // in the master's frame, read-only during the move loop
 
 public:
 
    Local () = default;
-   explicit Local (const Node & node) { m_node = &node; }
+   Local (const Node & node, const List & list) { m_node = &node; m_list = &list; }
 
    Score alpha;
    Score beta;
@@ -73,15 +78,34 @@ public:
    Move sing_move {move::None};
    Score sing_score {score::None};
 
-   List list;
    int i {0};
    int j {0};
 
    Move move {move::None};
    Score score {score::None};
-   Line pv;
 
    const Node & node () const { assert(m_node != nullptr); return *m_node; }
+   const List & list () const { assert(m_list != nullptr); return *m_list; }
+};
+
+class PV_Table { // triangular, one per thread
+
+private:
+
+   Move m_move[Ply_Size][Ply_Size];
+   int m_size[Ply_Size];
+
+public:
+
+   void clear  (Ply ply) { m_size[ply] = 0; }
+   void concat (Ply ply, Move mv);   // pv[ply] = mv + pv[ply + 1]
+   void copy   (Ply ply, Ply from);  // same node searched at another ply
+   void set    (Ply ply, const Line & pv);
+
+   Line line (Ply ply) const;
+
+   int          size  (Ply ply) const { return m_size[ply]; }
+   const Move * begin (Ply ply) const { return &m_move[ply][0]; }
 };
 
 class Search_Global;
@@ -95,34 +119,79 @@ private:
    Search_Global * m_sg;
 
    Local m_local;
+   Line m_pv;
 
    std::atomic<int> m_workers;
    std::atomic<bool> m_stop;
+   std::atomic<bool> m_open; // moves left for helpers
 
 public:
 
    void init_root  ();
-   void init       (Split_Point * parent, Search_Global & sg, const Local & local);
-   void get_result (Local & local);
+   void init       (Split_Point * parent, Search_Global & sg, const Local & local, const PV_Table & pv);
+   void get_result (Local & local, PV_Table & pv);
 
-   void enter ();
-   void leave ();
+   bool try_enter ();
+   void leave     ();
 
    Move get_move (Local & local);
-   void update   (Move mv, Score sc, const Line & pv);
+   void update   (Move mv, Score sc, const PV_Table & pv);
 
    void stop_root ();
 
    bool is_child (Split_Point * sp);
 
-   bool stop () const { return m_stop; }
+   bool stop () const { return m_stop.load(std::memory_order_relaxed); }
    bool free () const { return m_workers == 0; }
+   bool open () const { return m_open.load(std::memory_order_relaxed); }
 
    Split_Point * parent () const { return m_parent; }
    const Local & local  () const { return m_local; }
 };
 
-class Search_Local : public Lockable {
+class Root_Table : public Lockable { // root-split mode: one result per root move, shared by all threads
+
+private:
+
+   static const int Size {128}; // as List
+
+   struct Entry {
+      Move move;
+      Score score; // None until searched
+      Score last; // previous iteration, for the aspiration window
+      Line pv;
+   };
+
+   Entry m_entry[Size];
+   std::atomic<int> m_size {0}; // read by idle helpers (open) while init rewrites it
+
+   std::atomic<int> m_next {0}; // next root move to hand out
+   std::atomic<int> m_busy {0}; // root moves being searched
+   int m_done {0};
+
+   int m_best {-1}; // reported to Search_Global, -1 = none yet
+
+public:
+
+   void init (const List & list);
+   void sort (List & list);
+
+   int  get_move ();
+   void update   (int i, Score sc, const Line & pv, Search_Global & sg);
+   void leave    ();
+
+   bool open () const { return m_next.load(std::memory_order_relaxed) < m_size; }
+   bool done () const { return m_next >= m_size && m_busy == 0; }
+
+   int size () const { return m_size; }
+
+   Move  move (int i) const { assert(i >= 0 && i < m_size); return m_entry[i].move; }
+   Score last (int i) const { assert(i >= 0 && i < m_size); return m_entry[i].last; }
+
+   PV_Line line (int i) const;
+};
+
+class Search_Local {
 
 private:
 
@@ -131,9 +200,9 @@ private:
    std::thread m_thread;
    ID m_id;
 
-   std::atomic<Split_Point *> m_work;
+   std::atomic<bool> m_idle;
    ml::Array<Split_Point *, Ply_Size> m_stack;
-   Split_Point m_pool[Pool_Size];
+   Split_Point m_pool[Pool_Size]; // split points are published here for other threads to steal
    std::atomic<int> m_pool_size;
 
    Search_Global * m_sg;
@@ -142,6 +211,17 @@ private:
    int64 m_leaf;
    int64 m_ply_sum;
 
+   Thread_Stats m_stats;
+   Tree_Stats m_tree;
+
+   int64 m_bb_hit; // thread's cache counts at start
+   int64 m_bb_miss;
+
+   History m_hist;
+   Killer m_killer;
+   Move_Index m_prev[Ply_Size]; // move leading to each ply, for counter moves
+   PV_Table m_pv;
+
 public:
 
    void init (ID id, Search_Global & sg);
@@ -150,29 +230,38 @@ public:
    void start_iter ();
    void end_iter   (Search_Output & so);
 
-   void search_root_try (const Node & node, const List & list, Depth depth);
+   void search_root_try   (const Node & node, const List & list, Depth depth);
+   void search_root_split ();
 
-   void give_work (Split_Point * sp);
+   Split_Point * give_work (Split_Point * wait_sp, Thread_Stats & stats);
 
-   bool idle (Split_Point * parent) const;
-   bool idle () const;
+   bool idle () const { return m_idle.load(std::memory_order_relaxed); }
+
+   const History & history () const { return m_hist; }
+         History & history ()       { return m_hist; }
 
 private:
 
    static void launch (Search_Local * sl, Split_Point * root_sp);
 
-   void idle_loop (Split_Point * wait_sp);
+   void bb_start (); // on the thread itself
+   void bb_end   ();
+
+   void          idle_loop (Split_Point * wait_sp);
+   Split_Point * find_work (Split_Point * wait_sp);
 
    void join      (Split_Point * sp);
    void move_loop (Split_Point * sp);
 
+   void  root_work   ();
+   void  root_move   (int i);
    void  search_asp  (const Node & node, const List & list, Depth depth, Ply ply, bool prune);
    void  search_root (const Node & node, const List & list, Score alpha, Score beta, Depth depth, Ply ply, bool prune);
-   Score search      (const Node & node, Score alpha, Score beta, Depth depth, Ply ply, bool prune, Move skip_move, Line & pv);
-   Score qs          (const Node & node, Score alpha, Score beta, Depth depth, Ply ply, Line & pv);
+   Score search      (const Node & node, Score alpha, Score beta, Depth depth, Ply ply, bool prune, Move skip_move);
+   Score qs          (const Node & node, Score alpha, Score beta, Depth depth, Ply ply);
 
    void  move_loop   (Local & local);
-   Score search_move (Move mv, const Local & local, Line & pv);
+   Score search_move (Move mv, const Local & local);
 
    void split (Local & local);
 
@@ -206,13 +295,27 @@ private:
    const Node * m_node;
    List m_list;
 
+   TT * m_tt;
+   Time m_time;
+
+   int m_threads;
    int m_bb_size;
+   int64 m_nodes; // node limit
 
-   Search_Local m_sl[16];
+   Search_Local m_sl[Thread_Max];
 
    Split_Point m_root_sp;
 
-   Depth m_depth;
+   bool m_root_split;
+   Root_Table m_root_table;
+
+   std::thread m_timer; // time limits and input
+   std::atomic<bool> m_done;
+
+   std::atomic<Depth> m_depth; // also read by the timer thread
+
+   int m_pv_size; // multi-PV
+   int m_pv_slot;
 
    std::atomic<bool> m_ponder;
    std::atomic<bool> m_flag;
@@ -220,7 +323,8 @@ private:
    Move m_last_move;
    Score m_last_score;
 
-   double m_factor;
+   std::atomic<double> m_factor; // also read by the timer thread
+   bool m_single; // only one legal move, fixed before the timer thread starts
 
 public:
 
@@ -229,19 +333,25 @@ public:
 
    void search        (Depth depth);
    void collect_stats ();
+   void merge_history ();
 
    void new_best_move (Move mv, Score sc, Flag flag, Depth depth, const Line & pv);
 
-   void poll  ();
+   int pv_slot () const { return m_pv_slot; }
+
    void abort ();
 
    bool has_worker () const;
-   void broadcast  (Split_Point * sp);
 
    List & list () { return m_list; } // HACK
 
    Split_Point * root_sp () { return &m_root_sp; }
 
+   bool root_split () const { return m_root_split; }
+   Root_Table & root_table () { return m_root_table; }
+
+   const Node & node () const { return *m_node; }
+
    void set_flag () { m_flag = true; }
 
    Depth depth () const { return m_depth; }
@@ -253,8 +363,25 @@ public:
 
    double factor () const { return m_factor; }
 
+   TT & tt () const { return *m_tt; }
+   const Time & time () const { return m_time; }
+
+   int  threads () const { return m_threads; }
+   bool smp     () const { return m_threads > 1; }
+
+   int64 nodes () const { return m_nodes; }
+
    int bb_size () const { return m_bb_size; }
 
+private:
+
+   static void launch (Search_Global * sg);
+
+   void timer_loop ();
+   void poll       ();
+
+public:
+
    const Search_Local & sl (ID id) const { return m_sl[id]; }
          Search_Local & sl (ID id)       { return m_sl[id]; }
 
@@ -262,17 +389,12 @@ public:
    const Search_Output & so () const { assert(m_so != nullptr); return *m_so; }
 };
 
-struct SMP : public Lockable {
-   std::atomic<bool> busy {false};
-};
-
 class Abort : public std::exception {};
 
-// variables
+static_assert(Killer_Ply_Size >= Ply_Size, "");
 
-static Time G_Time;
+// variables
 
-static SMP G_SMP; // lock to create and broadcast split points
 static Lockable G_IO;
 
 // prototypes
@@ -285,7 +407,8 @@ static double lerp (double mg, double eg, double phase);
 
 static double time_lag (double time);
 
-static void local_update (Local & local, Move mv, Score sc, const Line & pv, Search_Global & sg);
+static bool local_update (Local & local, Move mv, Score sc);
+static void root_update  (const Local & local, const Line & pv, Search_Global & sg);
 
 static Flag flag (Score sc, Score alpha, Score beta);
 
@@ -295,14 +418,12 @@ void search(Search_Output & so, const Node & node, const Search_Input & si) {
 
    // init
 
-   var::update();
-
    so.init(si, node);
 
    int bb_size = var::BB_Size;
 
    if (bb::pos_is_load(node)) { // root position already in bitbases => only use smaller bitbases in search
-      G_TT.clear();
+      si.tt->clear();
       bb_size = pos::size(node) - 1;
    }
 
@@ -339,9 +460,8 @@ void search(Search_Output & so, const Node & node, const Search_Input & si) {
 
    // more init
 
-   G_Time.init(si, node);
-
-   Search_Global sg;
+   auto sg_ptr = std::make_unique<Search_Global>(); // megabytes, too large for thread stacks
+   Search_Global & sg = *sg_ptr;
    sg.init(si, so, node, list, bb_size); // also launches threads
 
    // iterative deepening
@@ -354,12 +474,15 @@ void search(Search_Output & so, const Node & node, const Search_Input & si) {
 
          sg.search(depth);
          sg.collect_stats();
+         so.end_iter();
 
          // early exit?
 
          bool abort = false;
 
-         if (si.smart && so.time() >= G_Time.time_0() * sg.factor() * lerp(0.4, 0.8, pos::phase(node))) {
+         if (var::Deterministic) {
+            // no-op (node limit only)
+         } else if (si.smart && so.time() >= sg.time().time_0() * sg.factor() * lerp(0.4, 0.8, pos::phase(node))) {
             abort = true;
          }
 
@@ -474,6 +597,118 @@ static double lerp(double mg, double eg, double phase) {
    return mg + (eg - mg) * phase;
 }
 
+void Thread_Stats::clear() {
+   splits = 0;
+   cuts = 0;
+   tries = 0;
+   joins = 0;
+   idle = 0.0;
+   bb_hit = 0;
+   bb_miss = 0;
+}
+
+#ifdef SEARCH_STATS
+
+void Tree_Stats::clear() {
+
+   for (int d = 0; d < Depth_Size; d++) {
+      m_tt_probe[d] = 0;
+      m_tt_hit[d] = 0;
+   }
+
+   m_node = 0;
+   m_qs_node = 0;
+   m_fail_high = 0;
+   m_fail_high_first = 0;
+   m_lmr = 0;
+   m_lmr_research = 0;
+   m_sing_try = 0;
+   m_sing_ext = 0;
+   m_prune_try = 0;
+   m_prune_cut = 0;
+   m_bb_probe = 0;
+}
+
+void Tree_Stats::add(const Tree_Stats & ts) {
+
+   for (int d = 0; d < Depth_Size; d++) {
+      m_tt_probe[d] += ts.m_tt_probe[d];
+      m_tt_hit[d] += ts.m_tt_hit[d];
+   }
+
+   m_node += ts.m_node;
+   m_qs_node += ts.m_qs_node;
+   m_fail_high += ts.m_fail_high;
+   m_fail_high_first += ts.m_fail_high_first;
+   m_lmr += ts.m_lmr;
+   m_lmr_research += ts.m_lmr_research;
+   m_sing_try += ts.m_sing_try;
+   m_sing_ext += ts.m_sing_ext;
+   m_prune_try += ts.m_prune_try;
+   m_prune_cut += ts.m_prune_cut;
+   m_bb_probe += ts.m_bb_probe;
+}
+
+void Tree_Stats::disp(Output_Type output) const {
+
+   auto rate = [](int64 n, int64 d) { return (d == 0) ? 0.0 : double(n) / double(d); };
+
+   std::string tt_hit;
+
+   for (int d = 0; d < Depth_Size; d++) {
+      if (m_tt_probe[d] == 0) continue;
+      if (!tt_hit.empty()) tt_hit += " ";
+      tt_hit += std::to_string(d) + ":" + ml::ftos(rate(m_tt_hit[d], m_tt_probe[d]), 3);
+   }
+
+   double first_cut = rate(m_fail_high_first, m_fail_high);
+   double research  = rate(m_lmr_research, m_lmr);
+   double singular  = rate(m_sing_ext, m_sing_try);
+   double prune     = rate(m_prune_cut, m_prune_try);
+   double qs_share  = rate(m_qs_node, m_node + m_qs_node);
+
+   G_IO.lock();
+
+   switch (output) {
+
+      case Output_None :
+
+         // no-op
+         break;
+
+      case Output_Terminal :
+
+         std::printf("tt hit rate by depth: %s\n", tt_hit.c_str());
+         std::printf("first-move cuts %5.1f%%  LMR re-searches %5.1f%% (%lld)  singular %5.1f%% (%lld)  probcut %5.1f%% (%lld)  QS %5.1f%%  BB probes %lld\n",
+                     first_cut * 100.0, research * 100.0, (long long)m_lmr, singular * 100.0, (long long)m_sing_try,
+                     prune * 100.0, (long long)m_prune_try, qs_share * 100.0, (long long)m_bb_probe);
+         std::fflush(stdout);
+         break;
+
+      case Output_Hub : {
+
+         std::string line = "info";
+         hub::add_pair(line, "tt-hit", tt_hit);
+         hub::add_pair(line, "first-cut", ml::ftos(first_cut, 3));
+         hub::add_pair(line, "lmr", std::to_string(m_lmr));
+         hub::add_pair(line, "lmr-research", ml::ftos(research, 3));
+         hub::add_pair(line, "singular", std::to_string(m_sing_try));
+         hub::add_pair(line, "singular-ext", ml::ftos(singular, 3));
+         hub::add_pair(line, "probcut", std::to_string(m_prune_try));
+         hub::add_pair(line, "probcut-cut", ml::ftos(prune, 3));
+         hub::add_pair(line, "qs-share", ml::ftos(qs_share, 3));
+         hub::add_pair(line, "bb-probes", std::to_string(m_bb_probe));
+         hub::write(line);
+
+         break;
+      }
+   }
+
+   G_IO.unlock();
+}
+
+#endif
+
 void Search_Input::init() {
 
    move = true;
@@ -488,6 +723,8 @@ void Search_Input::init() {
    time = 1E6;
    inc = 0.0;
    ponder = false;
+
+   multipv = 1;
 }
 
 void Search_Input::set_time(int moves, double time, double inc) {
@@ -515,10 +752,150 @@ void Search_Output::init(const Search_Input & si, const Pos & pos) {
    node = 0;
    leaf = 0;
    ply_sum = 0;
+
+   signature = 0;
+   m_iter_node = 0;
+
+   bb_hit = 0;
+   bb_miss = 0;
+
+   thread.clear();
 }
 
 void Search_Output::end() {
+
    m_timer.stop();
+
+   if (node != m_iter_node) end_iter(); // partial iteration, not closed by search()
+
+   if (bb::comp_cache()) { // threads have ended => their counts are in
+
+      for (const Thread_Stats & ts : thread) {
+         bb_hit  += ts.bb_hit;
+         bb_miss += ts.bb_miss;
+      }
+
+      if (bb_hit + bb_miss != 0) disp_bb_cache();
+   }
+
+   if (thread.size() > 1) disp_threads();
+   if (var::Deterministic) disp_signature();
+
+#ifdef SEARCH_STATS
+   tree.disp(m_si->output);
+#endif
+}
+
+void Search_Output::end_iter() { // tree signature
+   signature = (signature ^ uint64(node)) * 0x9E3779B97F4A7C15;
+   signature ^= signature >> 32;
+   m_iter_node = node;
+}
+
+void Search_Output::disp_signature() const {
+
+   char hex[17];
+   std::snprintf(hex, sizeof hex, "%016llx", (unsigned long long)signature);
+
+   switch (m_si->output) {
+
+      case Output_None :
+
+         // no-op
+         break;
+
+      case Output_Terminal :
+
+         std::printf("signature %s\n", hex);
+         std::fflush(stdout);
+         break;
+
+      case Output_Hub : {
+
+         std::string line = "info";
+         hub::add_pair(line, "signature", hex);
+         hub::write(line);
+
+         break;
+      }
+   }
+}
+
+void Search_Output::disp_bb_cache() const {
+
+   double hit_rate = double(bb_hit) / double(bb_hit + bb_miss);
+
+   switch (m_si->output) {
+
+      case Output_None :
+
+         // no-op
+         break;
+
+      case Output_Terminal :
+
+         std::printf("bitbase cache: %lld hits %lld misses (%.1f%%)\n", (long long)bb_hit, (long long)bb_miss, hit_rate * 100.0);
+         std::fflush(stdout);
+         break;
+
+      case Output_Hub : {
+
+         std::string line = "info";
+         hub::add_pair(line, "bb-cache-hits", std::to_string(bb_hit));
+         hub::add_pair(line, "bb-cache-misses", std::to_string(bb_miss));
+         hub::add_pair(line, "bb-cache-hit-rate", ml::ftos(hit_rate, 3));
+         hub::write(line);
+
+         break;
+      }
+   }
+}
+
+void Search_Output::disp_threads() const {
+
+   double time = this->time();
+
+   G_IO.lock();
+
+   for (int id = 0; id < int(thread.size()); id++) {
+
+      const Thread_Stats & ts = thread[id];
+
+      double split_rate = (time < 0.01) ? 0.0 : double(ts.splits) / time;
+      double steal_rate = (ts.tries == 0) ? 0.0 : double(ts.joins) / double(ts.tries);
+      double idle_rate  = (time < 0.01) ? 0.0 : ts.idle / time;
+
+      switch (m_si->output) {
+
+         case Output_None :
+
+            // no-op
+            break;
+
+         case Output_Terminal :
+
+            std::printf("thread %2d: %9lld splits %8.1f/s %9lld cuts %9lld steals %5.1f%% idle %6.2fs %5.1f%%\n", id, (long long)ts.splits, split_rate, (long long)ts.cuts, (long long)ts.joins, steal_rate * 100.0, ts.idle, idle_rate * 100.0);
+            std::fflush(stdout);
+            break;
+
+         case Output_Hub : {
+
+            std::string line = "info";
+            hub::add_pair(line, "thread", std::to_string(id));
+            hub::add_pair(line, "splits", std::to_string(ts.splits));
+            hub::add_pair(line, "split-rate", ml::ftos(split_rate, 1));
+            hub::add_pair(line, "cuts", std::to_string(ts.cuts));
+            hub::add_pair(line, "steals", std::to_string(ts.joins));
+            hub::add_pair(line, "steal-rate", ml::ftos(steal_rate, 3));
+            hub::add_pair(line, "idle", ml::ftos(ts.idle, 3));
+            hub::write(line);
+
+            break;
+         }
+      }
+   }
+
+   G_IO.unlock();
 }
 
 void Search_Output::new_best_move(Move mv, Score sc) {
@@ -542,7 +919,7 @@ void Search_Output::new_best_move(Move mv, Score sc, Flag flag, Depth depth, con
    this->depth = depth;
    this->pv = pv;
 
-   if (var::SMP) G_IO.lock();
+   G_IO.lock();
 
    double time = this->time();
    double speed = (time < 0.01) ? 0.0 : double(node) / time;
@@ -576,7 +953,50 @@ void Search_Output::new_best_move(Move mv, Score sc, Flag flag, Depth depth, con
       }
    }
 
-   if (var::SMP) G_IO.unlock();
+   G_IO.unlock();
+}
+
+void Search_Output::disp_multipv() const {
+
+   G_IO.lock();
+
+   double time = this->time();
+   double speed = (time < 0.01) ? 0.0 : double(node) / time;
+
+   for (int i = 0; i < int(multipv.size()); i++) {
+
+      const PV_Line & pl = multipv[i];
+
+      switch (m_si->output) {
+
+         case Output_None :
+
+            // no-op
+            break;
+
+         case Output_Terminal :
+
+            std::printf("%d. %2d/%4.1f%+7.2f%11ld%7.2f%5.1f  %s\n", i + 1, depth, ply_avg(), double(pl.score) / 100.0, node, time, speed / 1E6, pl.pv.to_string(m_pos, 7).c_str());
+            std::fflush(stdout);
+            break;
+
+         case Output_Hub : {
+
+            std::string line = "info";
+            hub::add_pair(line, "multipv", std::to_string(i + 1));
+            hub::add_pair(line, "depth", std::to_string(depth));
+            if (pl.score != score::None) hub::add_pair(line, "score", ml::ftos(double(pl.score) / 100.0, 2));
+            if (node != 0)               hub::add_pair(line, "nodes", std::to_string(node));
+            if (time >= 0.001)           hub::add_pair(line, "time", ml::ftos(time, 3));
+            if (pl.pv.size() != 0)       hub::add_pair(line, "pv", pl.pv.to_hub(m_pos));
+            hub::write(line);
+
+            break;
+         }
+      }
+   }
+
+   G_IO.unlock();
 }
 
 double Search_Output::ply_avg() const {
@@ -636,9 +1056,29 @@ void Search_Global::init(const Search_Input & si, Search_Output & so, const Node
 
    m_node = &node;
    m_list = list;
+   m_single = list.size() == 1;
+
+   m_tt = si.tt;
+   m_time.init(si, node);
+
+   m_threads = (si.threads != 0) ? si.threads : var::Threads;
+   assert(m_threads >= 1 && m_threads <= Thread_Max);
+
+   m_nodes = si.nodes;
+
+   if (var::Deterministic) { // reproducible tree: one thread, fresh TT, nodes instead of time
+      m_threads = 1;
+      m_nodes = std::min(m_nodes, int64(m_time.time_0() * Deterministic_NPS));
+      m_tt->clear();
+   }
 
    m_depth = Depth(0);
 
+   m_pv_size = std::max(std::min(si.multipv, list.size()), 1);
+   m_pv_slot = 0;
+
+   m_root_split = var::Root_Split && smp() && !si.move; // analysis only
+
    m_ponder = si.ponder;
    m_flag = false;
 
@@ -651,15 +1091,28 @@ void Search_Global::init(const Search_Input & si, Search_Output & so, const Node
 
    m_bb_size = bb_size;
 
-   G_SMP.busy = false;
    m_root_sp.init_root();
 
-   for (int id = 0; id < var::Threads; id++) {
+   for (int id = 0; id < m_threads; id++) {
       sl(ID(id)).init(ID(id), *this); // also launches a thread if id /= 0
    }
 
-   G_TT.inc_date();
-   sort_clear();
+   m_tt->inc_date();
+
+   m_done = false;
+   m_timer = std::thread(launch, this);
+}
+
+void Search_Global::launch(Search_Global * sg) {
+   sg->timer_loop();
+}
+
+void Search_Global::timer_loop() { // search threads only watch the root stop flag
+
+   while (!m_done) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      poll();
+   }
 }
 
 void Search_Global::collect_stats() {
@@ -668,7 +1121,10 @@ void Search_Global::collect_stats() {
    m_so->leaf = 0;
    m_so->ply_sum = 0;
 
-   for (int id = 0; id < var::Threads; id++) {
+   m_so->thread.resize(m_threads);
+   m_so->tree.clear();
+
+   for (int id = 0; id < m_threads; id++) {
       sl(ID(id)).end_iter(*m_so);
    }
 }
@@ -677,23 +1133,81 @@ void Search_Global::end() {
 
    abort();
 
+   m_done = true;
+   m_timer.join();
+
    m_root_sp.leave();
    assert(m_root_sp.free());
 
-   for (int id = 0; id < var::Threads; id++) {
+   for (int id = 0; id < m_threads; id++) {
       sl(ID(id)).end();
    }
+
+   collect_stats(); // include the last (partial) iteration
 }
 
 void Search_Global::search(Depth depth) {
 
    m_depth = depth;
 
-   for (int id = 0; id < var::Threads; id++) {
+   if (smp() && depth > 1) merge_history();
+
+   for (int id = 0; id < m_threads; id++) {
       sl(ID(id)).start_iter();
    }
 
-   sl(ID_Main).search_root_try(*m_node, m_list, depth);
+   if (m_root_split) {
+
+      m_root_table.init(m_list);
+      sl(ID_Main).search_root_split();
+      m_root_table.sort(m_list); // best first
+
+      if (m_pv_size > 1) { // every root move has an exact score already
+
+         m_so->multipv.resize(m_pv_size);
+
+         for (int i = 0; i < m_pv_size; i++) {
+            m_so->multipv[i] = m_root_table.line(i);
+         }
+
+         m_so->disp_multipv();
+      }
+
+   } else {
+
+      sl(ID_Main).search_root_try(*m_node, m_list, depth);
+   }
+
+   // multi-PV: the next best moves, excluding those already found
+
+   if (m_pv_size > 1 && !m_root_split) {
+
+      m_so->multipv.resize(m_pv_size);
+      m_so->multipv[0] = {m_so->move, m_so->score, m_so->flag, m_so->pv};
+
+      for (m_pv_slot = 1; m_pv_slot < m_pv_size; m_pv_slot++) {
+
+         List list;
+
+         for (Move mv : m_list) {
+
+            bool found = false;
+
+            for (int i = 0; i < m_pv_slot; i++) {
+               if (m_so->multipv[i].move == mv) found = true;
+            }
+
+            if (!found) list.add(mv);
+         }
+
+         sl(ID_Main).search_root_try(*m_node, list, depth);
+      }
+
+      m_pv_slot = 0;
+
+      std::stable_sort(m_so->multipv.begin(), m_so->multipv.end(), [](const PV_Line & a, const PV_Line & b) { return a.score > b.score; });
+      m_so->disp_multipv();
+   }
 
    // time management
 
@@ -708,9 +1222,28 @@ void Search_Global::search(Depth depth) {
    m_last_score = sc;
 }
 
+void Search_Global::merge_history() { // between iterations => no thread is searching
+
+   History hist = sl(ID_Main).history();
+
+   for (int id = 1; id < m_threads; id++) {
+      hist.merge(sl(ID(id)).history(), id + 1);
+   }
+
+   for (int id = 0; id < m_threads; id++) {
+      sl(ID(id)).history() = hist;
+   }
+}
+
 void Search_Global::new_best_move(Move mv, Score sc, Flag flag, Depth depth, const Line & pv) {
 
-   if (var::SMP) lock();
+   if (smp()) lock();
+
+   if (m_pv_slot != 0) { // secondary PV => no effect on the search result
+      m_so->multipv[m_pv_slot] = {mv, sc, flag, pv};
+      if (smp()) unlock();
+      return;
+   }
 
    Move bm = m_so->move;
 
@@ -725,12 +1258,11 @@ void Search_Global::new_best_move(Move mv, Score sc, Flag flag, Depth depth, con
       m_flag = false;
 
       if (m_si->smart) {
-         m_factor = std::max(m_factor, 1.0);
-         m_factor = std::min(m_factor * 1.2, 2.0);
+         m_factor = std::min(std::max(m_factor.load(), 1.0) * 1.2, 2.0);
       }
    }
 
-   if (var::SMP) unlock();
+   if (smp()) unlock();
 }
 
 void Search_Global::poll() {
@@ -739,7 +1271,7 @@ void Search_Global::poll() {
 
    // input event?
 
-   if (var::SMP) G_IO.lock();
+   G_IO.lock();
 
    if (m_si->input && has_input()) {
 
@@ -757,26 +1289,26 @@ void Search_Global::poll() {
       } else if (command == "ponder-hit") {
          get_line(line);
          m_ponder = false;
-         if (m_flag || m_list.size() == 1) abort = true;
+         if (m_flag || m_single) abort = true;
       } else { // other command => abort search
          m_ponder = false;
          abort = true;
       }
    }
 
-   if (var::SMP) G_IO.unlock();
+   G_IO.unlock();
 
    // time limit?
 
    double time = m_so->time();
 
-   if (m_depth <= depth_min()) {
+   if (m_depth <= depth_min() || var::Deterministic) {
       // no-op
-   } else if (time >= G_Time.time_1()) {
+   } else if (time >= m_time.time_1()) {
       abort = true;
    } else if (m_si->smart) {
       // no-op
-   } else if (time >= G_Time.time_0() * factor()) {
+   } else if (time >= m_time.time_0() * factor()) {
       abort = true;
    }
 
@@ -792,27 +1324,18 @@ void Search_Global::abort() {
 
 bool Search_Global::has_worker() const {
 
-   if (G_SMP.busy) return false;
-
-   for (int id = 0; id < var::Threads; id++) {
+   for (int id = 0; id < m_threads; id++) {
       if (sl(ID(id)).idle()) return true;
    }
 
    return false;
 }
 
-void Search_Global::broadcast(Split_Point * sp) {
-
-   for (int id = 0; id < var::Threads; id++) {
-      sl(ID(id)).give_work(sp);
-   }
-}
-
 void Search_Local::init(ID id, Search_Global & sg) {
 
    m_id = id;
 
-   m_work = sg.root_sp(); // to make it non-null
+   m_idle = false;
    m_stack.clear();
    m_pool_size = 0;
 
@@ -822,15 +1345,43 @@ void Search_Local::init(ID id, Search_Global & sg) {
    m_leaf = 0;
    m_ply_sum = 0;
 
-   if (var::SMP && m_id != ID_Main) m_thread = std::thread(launch, this, sg.root_sp());
+   m_stats.clear();
+   m_tree.clear();
+
+   m_hist.clear();
+   m_killer.clear();
+   m_prev[Ply_Root] = Move_Index_None;
+
+   if (m_id == ID_Main) bb_start();
+   if (sg.smp() && m_id != ID_Main) m_thread = std::thread(launch, this, sg.root_sp());
 }
 
 void Search_Local::launch(Search_Local * sl, Split_Point * root_sp) {
+   sl->bb_start();
    sl->idle_loop(root_sp);
+   sl->bb_end();
 }
 
 void Search_Local::end() {
-   if (var::SMP && m_id != ID_Main) m_thread.join();
+
+   if (m_id == ID_Main) {
+      bb_end();
+   } else if (m_sg->smp()) {
+      m_thread.join();
+   }
+}
+
+void Search_Local::bb_start() {
+   bb::comp_cache_stats(m_bb_hit, m_bb_miss);
+}
+
+void Search_Local::bb_end() {
+
+   int64 hit, miss;
+   bb::comp_cache_stats(hit, miss);
+
+   m_stats.bb_hit  += hit  - m_bb_hit;
+   m_stats.bb_miss += miss - m_bb_miss;
 }
 
 void Search_Local::start_iter() {
@@ -841,59 +1392,109 @@ void Search_Local::start_iter() {
 
 void Search_Local::end_iter(Search_Output & so) {
 
-   if (var::SMP || m_id == ID_Main) {
+   if (m_sg->smp() || m_id == ID_Main) {
       so.node += m_node;
       so.leaf += m_leaf;
       so.ply_sum += m_ply_sum;
    }
+
+   so.thread[m_id] = m_stats;
+   so.tree.add(m_tree);
 }
 
 void Search_Local::idle_loop(Split_Point * wait_sp) {
 
    push_sp(wait_sp);
 
-   while (true) {
+   uint64 idle = 0; // in ticks
+   uint64 start = tick();
+
+   m_idle = true;
+
+   while (!wait_sp->free()) { // spin
+
+      if (wait_sp == m_sg->root_sp()
+       && m_sg->root_split()
+       && m_sg->root_table().open()
+       && !wait_sp->stop()
+       ) {
+
+         idle += tick() - start;
+         m_idle = false;
+
+         try {
+            root_work();
+         } catch (const Abort &) {
+            // no-op
+         }
+
+         m_idle = true;
+         start = tick();
+
+         continue;
+      }
 
-      assert(m_work == m_sg->root_sp());
-      m_work = nullptr;
+      Split_Point * work = find_work(wait_sp);
 
-      while (!wait_sp->free() && m_work.load() == nullptr) // spin
-         ;
+      if (work != nullptr) {
 
-      Split_Point * work = m_work.exchange(m_sg->root_sp()); // to make it non-null
-      if (work == nullptr) break;
+         idle += tick() - start;
+         m_idle = false;
 
-      join(work);
+         join(work);
+
+         m_idle = true;
+         start = tick();
+      }
    }
 
+   m_idle = false;
+
+   idle += tick() - start;
+   m_stats.idle += tick_time(idle);
+
    pop_sp(wait_sp);
 
    assert(wait_sp->free());
-   assert(m_work == m_sg->root_sp());
 }
 
-void Search_Local::give_work(Split_Point * sp) {
+Split_Point * Search_Local::find_work(Split_Point * wait_sp) {
 
-   if (idle(sp->parent())) {
+   for (int i = 1; i < m_sg->threads(); i++) {
 
-      sp->enter();
+      ID id = ID((m_id + i) % m_sg->threads());
 
-      assert(m_work.load() == nullptr);
-      m_work = sp;
+      Split_Point * sp = m_sg->sl(id).give_work(wait_sp, m_stats);
+      if (sp != nullptr) return sp;
    }
+
+   return nullptr;
 }
 
-bool Search_Local::idle(Split_Point * parent) const {
+Split_Point * Search_Local::give_work(Split_Point * wait_sp, Thread_Stats & stats) { // called by an idle thread
 
-   lock();
-   bool idle = this->idle() && parent->is_child(top_sp());
-   unlock();
+   int size = m_pool_size.load(std::memory_order_acquire);
 
-   return idle;
-}
+   for (int i = 0; i < size; i++) { // oldest (largest) split points first
+
+      Split_Point * sp = &m_pool[i];
+      if (!sp->open()) continue; // pre-filter (atomic), "m_parent" is only stable once entered
+
+      stats.tries += 1;
+
+      if (!sp->try_enter()) continue; // already finished
+
+      // the split point cannot be recycled now that we are in (its ancestors neither)
 
-bool Search_Local::idle() const {
-   return m_work.load() == nullptr;
+      if (sp->open() && sp->parent()->is_child(wait_sp)) { // "helpful master" constraint
+         stats.joins += 1;
+         return sp;
+      }
+
+      sp->leave();
+   }
+
+   return nullptr;
 }
 
 void Search_Local::search_root_try(const Node & node, const List & list, Depth depth) {
@@ -916,10 +1517,121 @@ void Search_Local::search_root_try(const Node & node, const List & list, Depth d
    assert(m_stack.empty());
 }
 
+void Search_Local::search_root_split() {
+
+   assert(m_sg->depth() > 0 && m_sg->depth() <= Depth_Max);
+
+   assert(m_stack.empty());
+   push_sp(m_sg->root_sp());
+
+   Root_Table & rt = m_sg->root_table();
+
+   try {
+
+      root_work();
+
+      while (!rt.done()) { // help the threads that are still searching root moves
+
+         poll();
+
+         Split_Point * work = find_work(m_sg->root_sp());
+         if (work != nullptr) join(work);
+      }
+
+   } catch (const Abort &) {
+      pop_sp(m_sg->root_sp());
+      assert(m_stack.empty());
+      throw;
+   }
+
+   pop_sp(m_sg->root_sp());
+   assert(m_stack.empty());
+}
+
+void Search_Local::root_work() { // take whole root moves until there are none left
+
+   Root_Table & rt = m_sg->root_table();
+
+   while (true) {
+
+      int i = rt.get_move();
+      if (i < 0) break;
+
+      try {
+         root_move(i);
+      } catch (const Abort &) {
+         rt.leave();
+         throw;
+      }
+
+      rt.leave();
+   }
+}
+
+void Search_Local::root_move(int i) {
+
+   Root_Table & rt = m_sg->root_table();
+
+   const Node & node = m_sg->node();
+   Depth depth = m_sg->depth();
+
+   Move mv = rt.move(i);
+   Score last_score = rt.last(i);
+
+   inc_node();
+
+   Node new_node = node.succ(mv);
+   Depth new_depth = depth - Depth(1);
+
+   m_prev[Ply_Root + Ply(1)] = move::index(mv, node);
+
+   Score sc = score::None;
+
+   // window loop, as in search_asp() but around this move's own score
+
+   if (depth >= 4 && score::is_eval(last_score)) {
+
+      int margin = (var::Variant == var::Normal) ? 10 : 20;
+
+      int alpha_margin = margin;
+      int beta_margin  = margin;
+
+      while (std::max(alpha_margin, beta_margin) < 500) {
+
+         Score alpha = last_score - Score(alpha_margin);
+         Score beta  = last_score + Score(beta_margin);
+         assert(-score::Eval_Inf <= alpha && alpha < beta && beta <= +score::Eval_Inf);
+
+         sc = -search(new_node, -beta, -alpha, new_depth, Ply_Root + Ply(1), true, move::None);
+
+         if (!score::is_eval(sc)) {
+            sc = score::None;
+            break;
+         } else if (sc <= alpha) {
+            alpha_margin *= 2;
+            sc = score::None;
+         } else if (sc >= beta) {
+            beta_margin *= 2;
+            sc = score::None;
+         } else {
+            break;
+         }
+      }
+   }
+
+   if (sc == score::None) {
+      sc = -search(new_node, -score::Inf, +score::Inf, new_depth, Ply_Root + Ply(1), true, move::None);
+   }
+
+   assert(score::is_ok(sc));
+
+   m_pv.concat(Ply_Root, mv);
+   rt.update(i, sc, m_pv.line(Ply_Root), *m_sg);
+}
+
 void Search_Local::join(Split_Point * sp) {
 
-   // sp->enter();
-   push_sp(sp);
+   push_sp(sp); // sp->enter() was done by the caller
 
    try {
       move_loop(sp);
@@ -941,11 +1653,8 @@ void Search_Local::move_loop(Split_Point * sp) {
       if (mv == move::None) break;
 
       if (mv != local.skip_move) {
-
-         Line pv;
-         Score sc = search_move(mv, local, pv);
-
-         sp->update(mv, sc, pv);
+         Score sc = search_move(mv, local);
+         sp->update(mv, sc, m_pv);
       }
    }
 }
@@ -960,7 +1669,7 @@ void Search_Local::search_asp(const Node & node, const List & list, Depth depth,
 
    // window loop
 
-   if (depth >= 4 && score::is_eval(last_score)) {
+   if (depth >= 4 && score::is_eval(last_score) && m_sg->pv_slot() == 0) { // full window for secondary PVs
 
       int margin = (var::Variant == var::Normal) ? 10 : 20;
 
@@ -1001,7 +1710,9 @@ void Search_Local::search_root(const Node & node, const List & list, Score alpha
 
    // init
 
-   Local local(node);
+   List root_list = list; // the global list is re-ordered during search
+
+   Local local(node, root_list);
 
    local.alpha = alpha;
    local.beta = beta;
@@ -1016,16 +1727,15 @@ void Search_Local::search_root(const Node & node, const List & list, Score alpha
 
    local.move = move::None;
    local.score = score::None;
-   local.pv.clear();
 
-   // move loop
+   m_pv.clear(local.ply);
 
-   local.list = list;
+   // move loop
 
    move_loop(local);
 }
 
-Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth depth, Ply ply, bool prune, Move skip_move, Line & pv) {
+Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth depth, Ply ply, bool prune, Move skip_move) {
 
    assert(-score::Inf <= alpha && alpha < beta && beta <= +score::Inf);
    assert(depth <= Depth_Max);
@@ -1036,17 +1746,20 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
 
    // QS
 
-   pv.clear();
+   m_pv.clear(ply);
 
    if (node.is_draw(2)) return leaf(Score(0), ply);
 
-   if (depth <= 0) return qs(node, alpha, beta, Depth(0), ply, pv);
+   if (depth <= 0) return qs(node, alpha, beta, Depth(0), ply);
 
    if (pos::is_wipe(node)) return end_score(node, ply); // for BT variant
 
+   m_tree.node();
+
    // init
 
-   Local local(node);
+   List list;
+   Local local(node, list);
 
    local.alpha = alpha;
    local.beta = beta;
@@ -1061,7 +1774,6 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
 
    local.move = move::None;
    local.score = score::None;
-   local.pv.clear();
 
    // transposition table
 
@@ -1075,7 +1787,10 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
       Flag tt_flag;
       Depth tt_depth;
 
-      if (G_TT.probe(key, tt_move, tt_score, tt_flag, tt_depth)) {
+      bool hit = m_sg->tt().probe(key, tt_move, tt_score, tt_flag, tt_depth);
+      m_tree.tt_probe(local.depth, hit);
+
+      if (hit) {
 
          tt_score = score::from_tt(tt_score, local.ply);
 
@@ -1096,8 +1811,8 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
          }
 
          if (tt_depth >= local.depth - 4 && is_lower(tt_flag) && score::is_eval(tt_score)) {
-            gen_moves(local.list, node); // HACK ###
-            local.sing_move  = list::find_index(local.list, tt_move, node);
+            gen_moves(list, node); // HACK ###
+            local.sing_move  = list::find_index(list, tt_move, node);
             local.sing_score = tt_score;
          }
       }
@@ -1107,26 +1822,25 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
 
    if (bb::pos_is_search(node, m_sg->bb_size())) {
 
-      Line new_pv;
-      Score sc = qs(node, local.alpha, local.beta, Depth(0), local.ply, new_pv); // captures + BB probe
+      Score sc = qs(node, local.alpha, local.beta, Depth(0), local.ply); // captures + BB probe
 
       if ((sc < 0 && sc <= local.alpha) || sc == 0 || (sc > 0 && sc >= local.beta)) {
          local.score = sc;
-         local.pv = new_pv;
          goto cont;
       }
 
       if (sc > 0) { // win => lower bound
          local.score = sc;
-         local.pv = new_pv;
+      } else {
+         m_pv.clear(local.ply);
       }
    }
 
    // gen moves
 
-   gen_moves(local.list, node);
+   gen_moves(list, node);
 
-   if (local.list.size() == 0) return end_score(node, local.ply); // no legal moves => end
+   if (list.size() == 0) return end_score(node, local.ply); // no legal moves => end
 
    if (score::loss(local.ply + Ply(2)) >= local.beta) { // loss-distance pruning
       return leaf(score::loss(local.ply + Ply(2)), local.ply);
@@ -1146,22 +1860,23 @@ Score Search_Local::search(const Node & node, Score alpha, Score beta, Depth dep
       Score new_beta = local.beta + margin;
       Depth new_depth = Depth(local.depth * 40 / 100);
 
-      Line new_pv;
-      Score sc = search(node, new_beta - Score(1), new_beta, new_depth, local.ply + Ply(1), false, move::None, new_pv);
+      m_prev[local.ply + 1] = m_prev[local.ply]; // same position
+      Score sc = search(node, new_beta - Score(1), new_beta, new_depth, local.ply + Ply(1), false, move::None);
+      m_tree.prune(sc >= new_beta);
 
       if (sc >= new_beta) {
 
          sc -= margin; // fail-soft margin
          assert(sc >= local.beta);
 
-         pv = new_pv;
+         m_pv.copy(local.ply, local.ply + Ply(1));
          return sc;
       }
    }
 
    // move loop
 
-   sort_moves(local.list, node, tt_move);
+   m_hist.sort_moves(list, node, tt_move, m_killer, local.ply, m_prev[local.ply]);
    move_loop(local);
 
 cont : // epilogue
@@ -1176,28 +1891,30 @@ cont : // epilogue
       Flag tt_flag = flag(local.score, local.alpha, local.beta);
       Depth tt_depth = local.depth;
 
-      G_TT.store(key, tt_move, tt_score, tt_flag, tt_depth);
+      m_sg->tt().store(key, tt_move, tt_score, tt_flag, tt_depth);
    }
 
+   if (local.score >= local.beta && local.move != move::None) m_tree.fail_high(local.j == 1);
+
    // move-ordering statistics
 
    if (local.score > local.alpha
     && local.move != move::None
-    && local.list.size() > 1
+    && list.size() > 1
     && local.skip_move == move::None
     ) {
 
-      good_move(local.move, node);
+      m_hist.good_move(local.move, node);
+      if (var::Killers && !move::is_capture(local.move, node)) m_killer.add(local.move, node, local.ply, m_prev[local.ply]);
 
-      assert(list::has(local.list, local.move));
+      assert(list::has(list, local.move));
 
-      for (Move mv : local.list) {
+      for (Move mv : list) {
          if (mv == local.move) break;
-         bad_move(mv, node);
+         m_hist.bad_move(mv, node);
       }
    }
 
-   pv = local.pv;
    return local.score;
 }
 
@@ -1206,16 +1923,16 @@ void Search_Local::move_loop(Local & local) {
    local.i = 0;
    local.j = 0;
 
-   while (local.score < local.beta && local.i < local.list.size()) {
+   while (local.score < local.beta && local.i < local.list().size()) {
 
       int searched_size = local.j;
 
       // SMP
 
-      if (var::SMP
+      if (m_sg->smp()
        && local.depth >= 6
        && searched_size != 0
-       && local.list.size() - searched_size >= 5
+       && local.list().size() - searched_size >= 5
        && m_sg->has_worker()
        && m_pool_size < Pool_Size
        ) {
@@ -1225,19 +1942,21 @@ void Search_Local::move_loop(Local & local) {
 
       // search move
 
-      Move mv = local.list[local.i++];
+      Move mv = local.list()[local.i++];
 
       if (mv != local.skip_move) {
 
-         Line pv;
-         Score sc = search_move(mv, local, pv);
+         Score sc = search_move(mv, local);
 
-         local_update(local, mv, sc, pv, *m_sg);
+         if (local_update(local, mv, sc)) {
+            m_pv.concat(local.ply, mv);
+            if (local.ply == Ply_Root) root_update(local, m_pv.line(Ply_Root), *m_sg);
+         }
       }
    }
 }
 
-Score Search_Local::search_move(Move mv, const Local & local, Line & pv) {
+Score Search_Local::search_move(Move mv, const Local & local) {
 
    // init
 
@@ -1260,10 +1979,12 @@ Score Search_Local::search_move(Move mv, const Local & local, Line & pv) {
 
       Score new_alpha = local.sing_score - Score(40);
 
-      Line new_pv;
-      Score sc = search(node, new_alpha, new_alpha + Score(1), local.depth - Depth(4), local.ply, local.prune, mv, new_pv);
+      Line pv = m_pv.line(local.ply); // the verification search is at the same ply
+      Score sc = search(node, new_alpha, new_alpha + Score(1), local.depth - Depth(4), local.ply, local.prune, mv);
+      m_pv.set(local.ply, pv);
 
       if (sc <= new_alpha) ext = Depth(1);
+      m_tree.singular(ext != 0);
    }
 
    Score new_alpha = std::max(local.alpha, local.score);
@@ -1278,25 +1999,28 @@ Score Search_Local::search_move(Move mv, const Local & local, Line & pv) {
    inc_node();
 
    Node new_node = local.node().succ(mv);
+   m_prev[local.ply + 1] = move::index(mv, local.node());
 
    if ((local.pv_node && searched_size != 0) || red != 0) {
 
-      sc = -search(new_node, -new_alpha - Score(1), -new_alpha, new_depth - red, local.ply + Ply(1), local.prune, move::None, pv);
+      sc = -search(new_node, -new_alpha - Score(1), -new_alpha, new_depth - red, local.ply + Ply(1), local.prune, move::None);
+
+      if (red != 0) m_tree.lmr(sc > new_alpha);
 
       if (sc > new_alpha) { // PVS/LMR re-search
-         sc = -search(new_node, -local.beta, -new_alpha, new_depth, local.ply + Ply(1), local.prune, move::None, pv);
+         sc = -search(new_node, -local.beta, -new_alpha, new_depth, local.ply + Ply(1), local.prune, move::None);
       }
 
    } else {
 
-      sc = -search(new_node, -local.beta, -new_alpha, new_depth, local.ply + Ply(1), local.prune, move::None, pv);
+      sc = -search(new_node, -local.beta, -new_alpha, new_depth, local.ply + Ply(1), local.prune, move::None);
    }
 
    assert(score::is_ok(sc));
    return sc;
 }
 
-Score Search_Local::qs(const Node & node, Score alpha, Score beta, Depth depth, Ply ply, Line & pv) {
+Score Search_Local::qs(const Node & node, Score alpha, Score beta, Depth depth, Ply ply) {
 
    assert(-score::Inf <= alpha && alpha < beta && beta <= +score::Inf);
    assert(depth <= 0);
@@ -1304,19 +2028,49 @@ Score Search_Local::qs(const Node & node, Score alpha, Score beta, Depth depth,
 
    // init
 
-   pv.clear();
+   m_pv.clear(ply);
 
    if (pos::is_wipe(node)) return end_score(node, ply); // for BT variant
 
+   m_tree.qs_node();
+
    if (score::loss(ply + Ply(2)) >= beta) { // loss-distance pruning
       return leaf(score::loss(ply + Ply(2)), ply);
    }
 
    if (ply >= Ply_Max) return leaf(eval(node), ply);
 
+   // transposition table (optional)
+
+   Key key = hash::key(node);
+
+   if (var::TT_QS) {
+
+      Move_Index tt_move;
+      Score tt_score;
+      Flag tt_flag;
+      Depth tt_depth;
+
+      bool hit = m_sg->tt().probe(key, tt_move, tt_score, tt_flag, tt_depth);
+      m_tree.tt_probe(Depth_QS, hit);
+
+      if (hit && tt_depth == Depth_QS && tt_score != score::None) { // QS entries only; search would re-store deeper bounds at its own depth
+
+         tt_score = score::from_tt(tt_score, ply);
+
+         if ((is_lower(tt_flag) && tt_score >= beta)
+          || (is_upper(tt_flag) && tt_score <= alpha)
+          ||  is_exact(tt_flag)
+          ) {
+            return tt_score;
+         }
+      }
+   }
+
    // move-loop init
 
    Score bs = score::None;
+   Move bm = move::None;
 
    List list;
    gen_captures(list, node);
@@ -1326,13 +2080,17 @@ Score Search_Local::qs(const Node & node, Score alpha, Score beta, Depth depth,
       // bitbases
 
       if (bb::pos_is_search(node, m_sg->bb_size())) {
+         m_tree.bb_probe();
          return leaf(bb_probe(node, ply), ply);
       }
 
       // threat position?
 
       if (depth == 0 && pos::is_threat(node)) {
-         return search(node, alpha, beta, Depth(1), ply + Ply(1), false, move::None, pv); // one-ply search
+         m_prev[ply + 1] = m_prev[ply]; // same position
+         Score sc = search(node, alpha, beta, Depth(1), ply + Ply(1), false, move::None); // one-ply search
+         m_pv.copy(ply, ply + Ply(1));
+         return sc;
       }
 
       // stand pat
@@ -1351,13 +2109,14 @@ Score Search_Local::qs(const Node & node, Score alpha, Score beta, Depth depth,
 
       inc_node();
 
-      Line new_pv;
-      Score sc = -qs(node.succ(mv), -beta, -std::max(alpha, bs), depth - Depth(1), ply + Ply(1), new_pv);
+      m_prev[ply + 1] = move::index(mv, node);
+      Score sc = -qs(node.succ(mv), -beta, -std::max(alpha, bs), depth - Depth(1), ply + Ply(1));
 
       if (sc > bs) {
 
          bs = sc;
-         pv.concat(mv, new_pv);
+         bm = mv;
+         m_pv.concat(ply, mv);
 
          if (sc >= beta) break;
       }
@@ -1366,38 +2125,38 @@ Score Search_Local::qs(const Node & node, Score alpha, Score beta, Depth depth,
    if (list.size() == 0) mark_leaf(ply);
 
    assert(score::is_ok(bs));
+
+   // transposition table (only at the root of QS, where threats are also searched)
+
+   if (var::TT_QS && depth == 0) {
+
+      Move_Index tt_move = (bs > alpha && bm != move::None) ? move::index(bm, node) : Move_Index_None;
+      m_sg->tt().store(key, tt_move, score::to_tt(bs, ply), flag(bs, alpha, beta), Depth_QS);
+   }
+
    return bs;
 }
 
 void Search_Local::split(Local & local) {
 
-   m_sg->poll();
    poll();
 
-   G_SMP.lock(); // useful?
-
-   assert(!G_SMP.busy);
-   G_SMP.busy = true;
-
-   assert(m_pool_size < Pool_Size);
-   Split_Point * sp = &m_pool[m_pool_size++];
-   sp->init(top_sp(), *m_sg, local);
-
-   m_sg->broadcast(sp);
+   int size = m_pool_size;
+   assert(size < Pool_Size);
 
-   assert(G_SMP.busy);
-   G_SMP.busy = false;
+   Split_Point * sp = &m_pool[size];
+   sp->init(top_sp(), *m_sg, local, m_pv);
 
-   G_SMP.unlock();
+   m_pool_size.store(size + 1, std::memory_order_release); // publish
+   m_stats.splits += 1;
 
    join(sp);
-   idle_loop(sp);
+   idle_loop(sp); // only helps descendants of sp
 
-   sp->get_result(local);
+   if (sp->stop()) m_stats.cuts += 1;
 
-   assert(m_pool_size > 0);
-   m_pool_size -= 1;
-   assert(sp == &m_pool[m_pool_size]);
+   m_pool_size.store(size, std::memory_order_release);
+   sp->get_result(local, m_pv);
 
    poll();
 }
@@ -1408,7 +2167,7 @@ Depth Search_Local::extend(Move mv, const Local & local) {
 
    const Node & node = local.node();
 
-   if (local.list.size() == 1) ext += 1;
+   if (local.list().size() == 1) ext += 1;
 
    if (var::Variant == var::Losing) {
 
@@ -1442,10 +2201,9 @@ Depth Search_Local::reduce(Move mv, const Local & local) { // LMR
 void Search_Local::inc_node() {
 
    m_node += 1;
-   if (m_node >= m_sg->si().nodes && m_sg->depth() > 1) m_sg->abort();
+   if (m_node >= m_sg->nodes() && m_sg->depth() > 1) m_sg->abort();
 
-   if ((m_node & ml::bit_mask(12)) == 0) m_sg->poll();
-   if ((m_node & ml::bit_mask( 4)) == 0) poll();
+   if ((m_node & ml::bit_mask(4)) == 0) poll();
 }
 
 Score Search_Local::end_score(const Pos & pos, Ply ply) { // pos for debug
@@ -1489,21 +2247,13 @@ bool Search_Local::stop() const {
 }
 
 void Search_Local::push_sp(Split_Point * sp) {
-
-   lock();
-
    if (!m_stack.empty()) assert(sp->is_child(top_sp()));
    m_stack.add(sp);
-
-   unlock();
 }
 
 void Search_Local::pop_sp(Split_Point * sp) { // sp for debug
-
-   lock();
    assert(top_sp() == sp);
    m_stack.remove();
-   unlock();
 }
 
 Split_Point * Search_Local::top_sp() const {
@@ -1518,9 +2268,10 @@ void Split_Point::init_root() {
 
    m_workers = 1; // master
    m_stop = false;
+   m_open = false;
 }
 
-void Split_Point::init(Split_Point * parent, Search_Global & sg, const Local & local) {
+void Split_Point::init(Split_Point * parent, Search_Global & sg, const Local & local, const PV_Table & pv) {
 
    assert(parent != nullptr);
 
@@ -1528,18 +2279,27 @@ void Split_Point::init(Split_Point * parent, Search_Global & sg, const Local & l
    m_sg = &sg;
 
    m_local = local;
+   m_pv = pv.line(local.ply);
 
-   m_workers = 1; // master
    m_stop = false;
+   m_open = true;
+   m_workers.store(1, std::memory_order_release); // master; makes the split point joinable
 }
 
-void Split_Point::get_result(Local & local) {
+void Split_Point::get_result(Local & local, PV_Table & pv) {
    local = m_local;
+   pv.set(local.ply, m_pv);
 }
 
-void Split_Point::enter() {
-   assert(m_workers != 0);
-   m_workers += 1;
+bool Split_Point::try_enter() {
+
+   int workers = m_workers.load();
+
+   do {
+      if (workers == 0) return false;
+   } while (!m_workers.compare_exchange_weak(workers, workers + 1));
+
+   return true;
 }
 
 void Split_Point::leave() {
@@ -1553,12 +2313,16 @@ Move Split_Point::get_move(Local & local) {
 
    lock();
 
-   if (m_local.score < m_local.beta && m_local.i < m_local.list.size()) {
+   const List & list = m_local.list();
+
+   if (m_local.score < m_local.beta && m_local.i < list.size()) {
 
-      mv = m_local.list[m_local.i++];
+      mv = list[m_local.i++];
 
       local.score = m_local.score;
       local.j = m_local.j;
+
+      if (m_local.i == list.size()) m_open = false;
    }
 
    unlock();
@@ -1566,19 +2330,29 @@ Move Split_Point::get_move(Local & local) {
    return mv;
 }
 
-void Split_Point::update(Move mv, Score sc, const Line & pv) {
+void Split_Point::update(Move mv, Score sc, const PV_Table & pv) {
 
    lock();
 
    if (m_local.score < m_local.beta) { // ignore superfluous moves after a fail high
-      local_update(m_local, mv, sc, pv, *m_sg);
-      if (m_local.score >= m_local.beta) m_stop = true;
+
+      Ply ply = m_local.ply;
+
+      if (local_update(m_local, mv, sc)) {
+         m_pv.concat(mv, pv.begin(ply + Ply(1)), pv.size(ply + Ply(1)));
+         if (ply == Ply_Root) root_update(m_local, m_pv, *m_sg);
+      }
+
+      if (m_local.score >= m_local.beta) {
+         m_stop = true;
+         m_open = false;
+      }
    }
 
    unlock();
 }
 
-static void local_update(Local & local, Move mv, Score sc, const Line & pv, Search_Global & sg) {
+static bool local_update(Local & local, Move mv, Score sc) { // true if new best move
 
    assert(score::is_ok(sc));
 
@@ -1586,17 +2360,22 @@ static void local_update(Local & local, Move mv, Score sc, const Line & pv, Sear
    assert(local.j <= local.i);
 
    if (sc > local.score) {
-
       local.move = mv;
       local.score = sc;
-      local.pv.concat(mv, pv);
-
-      if (local.ply == Ply_Root && (local.j == 1 || sc > local.alpha)) {
-         sg.new_best_move(local.move, local.score, flag(local.score, local.alpha, local.beta), local.depth, local.pv);
-      }
+      return true;
    }
 
    assert(score::is_ok(local.score));
+   return false;
+}
+
+static void root_update(const Local & local, const Line & pv, Search_Global & sg) {
+
+   assert(local.ply == Ply_Root);
+
+   if (local.j == 1 || local.score > local.alpha) {
+      sg.new_best_move(local.move, local.score, flag(local.score, local.alpha, local.beta), local.depth, pv);
+   }
 }
 
 void Split_Point::stop_root() {
@@ -1612,19 +2391,166 @@ bool Split_Point::is_child(Split_Point * sp) {
    return false;
 }
 
+void Root_Table::init(const List & list) { // between iterations
+
+   m_next = Size; // closed while filling
+
+   // helpers of the previous iteration can still be in get_move(), wait for them to leave
+
+   while (m_busy != 0) {
+      std::this_thread::yield();
+   }
+
+   Score last[Size];
+
+   for (int i = 0; i < list.size(); i++) {
+
+      last[i] = score::None;
+
+      for (int j = 0; j < m_size; j++) {
+         if (m_entry[j].move == list[i]) last[i] = m_entry[j].score;
+      }
+   }
+
+   m_size = list.size();
+
+   for (int i = 0; i < m_size; i++) {
+      m_entry[i].move = list[i];
+      m_entry[i].score = score::None;
+      m_entry[i].last = last[i];
+      m_entry[i].pv.clear();
+   }
+
+   m_done = 0;
+   m_best = -1;
+
+   m_next = 0; // open
+}
+
+void Root_Table::sort(List & list) { // best first, unsearched moves last; between iterations
+
+   std::stable_sort(&m_entry[0], &m_entry[m_size.load()], [](const Entry & a, const Entry & b) {
+      return a.score != score::None && (b.score == score::None || a.score > b.score);
+   });
+
+   for (int i = 0; i < list.size(); i++) {
+
+      for (int j = 0; j < m_size; j++) {
+         if (m_entry[j].move == list[i]) list.set_score(i, m_size - j);
+      }
+   }
+
+   list.sort();
+}
+
+int Root_Table::get_move() {
+
+   m_busy += 1; // before taking a move, see done()
+
+   int i = m_next++;
+
+   if (i >= m_size) {
+      m_busy -= 1;
+      return -1;
+   }
+
+   return i;
+}
+
+void Root_Table::leave() {
+   assert(m_busy > 0);
+   m_busy -= 1;
+}
+
+void Root_Table::update(int i, Score sc, const Line & pv, Search_Global & sg) {
+
+   assert(i >= 0 && i < m_size);
+   assert(score::is_ok(sc));
+
+   lock();
+
+   Entry & entry = m_entry[i];
+
+   entry.score = sc;
+   entry.pv = pv;
+
+   m_done += 1;
+
+   // report in root-move order: nothing before the first (previous best) move is done
+
+   if (m_entry[0].score != score::None) {
+
+      int best = m_best;
+
+      for (int j = 0; j < m_size; j++) {
+         if (m_entry[j].score != score::None && (best < 0 || m_entry[j].score > m_entry[best].score)) best = j;
+      }
+
+      if (best != m_best) {
+         m_best = best;
+         sg.new_best_move(m_entry[best].move, m_entry[best].score, Flag::Exact, sg.depth(), m_entry[best].pv);
+      }
+   }
+
+   unlock();
+}
+
+PV_Line Root_Table::line(int i) const {
+   assert(i >= 0 && i < m_size);
+   const Entry & entry = m_entry[i];
+   return {entry.move, entry.score, Flag::Exact, entry.pv};
+}
+
 void Line::set(Move mv) {
    clear();
    add(mv);
 }
 
-void Line::concat(Move mv, const Line & pv) {
+void Line::concat(Move mv, const Move pv[], int size) {
 
    clear();
    add(mv);
 
-   for (Move mv : pv) {
-      add(mv);
+   for (int i = 0; i < size; i++) {
+      add(pv[i]);
+   }
+}
+
+void PV_Table::concat(Ply ply, Move mv) {
+
+   assert(ply < Ply_Max);
+
+   int size = m_size[ply + 1];
+   assert(size < Ply_Size);
+
+   m_move[ply][0] = mv;
+   std::copy(&m_move[ply + 1][0], &m_move[ply + 1][size], &m_move[ply][1]);
+
+   m_size[ply] = size + 1;
+}
+
+void PV_Table::copy(Ply ply, Ply from) {
+
+   int size = m_size[from];
+
+   std::copy(&m_move[from][0], &m_move[from][size], &m_move[ply][0]);
+   m_size[ply] = size;
+}
+
+void PV_Table::set(Ply ply, const Line & pv) {
+   std::copy(pv.begin(), pv.end(), &m_move[ply][0]);
+   m_size[ply] = pv.size();
+}
+
+Line PV_Table::line(Ply ply) const {
+
+   Line pv;
+
+   for (int i = 0; i < m_size[ply]; i++) {
+      pv.add(m_move[ply][i]);
    }
+
+   return pv;
 }
 
 std::string Line::to_string(const Pos & pos, int size_max) const {
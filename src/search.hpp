@@ -4,7 +4,9 @@
 
 // includes
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "common.hpp"
 #include "libmy.hpp"
@@ -25,6 +27,10 @@ const Ply Ply_Root {Ply(0)};
 const Ply Ply_Max  {Ply(99)};
 const int Ply_Size {Ply_Max + 1};
 
+const int Thread_Max {16};
+
+const double Deterministic_NPS {1E6}; // converts time limits into node limits
+
 // types
 
 enum Output_Type { Output_None, Output_Terminal, Output_Hub };
@@ -43,7 +49,7 @@ public:
    void add   (Move mv) { m_move.add(mv); }
 
    void set    (Move mv);
-   void concat (Move mv, const Line & pv);
+   void concat (Move mv, const Move pv[], int size);
 
    int  size        ()      const { return m_move.size(); }
    Move operator [] (int i) const { return m_move[i]; }
@@ -72,6 +78,11 @@ public:
    double inc {0.0};
    bool ponder {false};
 
+   int multipv {1}; // number of root moves with an exact score (analysis)
+
+   int threads {0}; // 0 => "threads" option
+   TT * tt {&G_TT}; // concurrent searches need their own
+
 public:
 
    void init ();
@@ -79,6 +90,90 @@ public:
    void set_time (int moves, double time, double inc);
 };
 
+struct Thread_Stats { // SMP
+
+   int64 splits {0};
+   int64 cuts {0}; // splits stopped by a fail high
+   int64 tries {0}; // steal attempts
+   int64 joins {0}; // successful steals
+   double idle {0.0}; // seconds
+
+   int64 bb_hit {0}; // bitbase block cache, probes by this thread
+   int64 bb_miss {0};
+
+   void clear ();
+};
+
+class Tree_Stats { // search-tree profile, compiles to nothing without SEARCH_STATS
+
+#ifdef SEARCH_STATS
+
+private:
+
+   static const int Depth_Size {32};
+
+   int64 m_tt_probe[Depth_Size];
+   int64 m_tt_hit[Depth_Size];
+
+   int64 m_node; // search() calls
+   int64 m_qs_node; // qs() calls
+
+   int64 m_fail_high;
+   int64 m_fail_high_first;
+
+   int64 m_lmr;
+   int64 m_lmr_research;
+
+   int64 m_sing_try;
+   int64 m_sing_ext;
+
+   int64 m_prune_try;
+   int64 m_prune_cut;
+
+   int64 m_bb_probe;
+
+public:
+
+   void clear ();
+   void add   (const Tree_Stats & ts);
+
+   void tt_probe  (Depth depth, bool hit) { int d = std::min(std::max(int(depth), 0), Depth_Size - 1); m_tt_probe[d] += 1; if (hit) m_tt_hit[d] += 1; }
+   void node      () { m_node += 1; }
+   void qs_node   () { m_qs_node += 1; }
+   void fail_high (bool first) { m_fail_high += 1; if (first) m_fail_high_first += 1; }
+   void lmr       (bool research) { m_lmr += 1; if (research) m_lmr_research += 1; }
+   void singular  (bool ext) { m_sing_try += 1; if (ext) m_sing_ext += 1; }
+   void prune     (bool cut) { m_prune_try += 1; if (cut) m_prune_cut += 1; }
+   void bb_probe  () { m_bb_probe += 1; }
+
+   void disp (Output_Type output) const;
+
+#else
+
+public:
+
+   void clear () {}
+   void add   (const Tree_Stats &) {}
+
+   void tt_probe  (Depth, bool) {}
+   void node      () {}
+   void qs_node   () {}
+   void fail_high (bool) {}
+   void lmr       (bool) {}
+   void singular  (bool) {}
+   void prune     (bool) {}
+   void bb_probe  () {}
+
+#endif
+};
+
+struct PV_Line { // multi-PV
+   Move move;
+   Score score;
+   Flag flag;
+   Line pv;
+};
+
 class Search_Output {
 
 public:
@@ -94,12 +189,23 @@ public:
    int64 leaf {0};
    int64 ply_sum {0};
 
+   std::vector<Thread_Stats> thread;
+   Tree_Stats tree;
+   std::vector<PV_Line> multipv; // ranked, last iteration
+
+   uint64 signature {0}; // hash of per-iteration node counts
+
+   int64 bb_hit {0}; // bitbase block cache
+   int64 bb_miss {0};
+
 private:
 
    const Search_Input * m_si;
    Pos m_pos;
    Timer m_timer;
 
+   int64 m_iter_node {0}; // node count when the last iteration was closed
+
 public:
 
    void init (const Search_Input & si, const Pos & pos);
@@ -110,9 +216,16 @@ public:
 
    void new_best_move (Move mv, Score sc = score::None);
    void new_best_move (Move mv, Score sc, Flag flag, Depth depth, const Line & pv);
+   void disp_multipv  () const;
 
    double ply_avg () const;
    double time    () const;
+
+private:
+
+   void disp_threads   () const;
+   void disp_signature () const;
+   void disp_bb_cache  () const;
 };
 
 // functions
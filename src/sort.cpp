@@ -16,37 +16,84 @@ const int Prob_One   {1 << Prob_Bit};
 const int Prob_Half  {1 << (Prob_Bit - 1)};
 const int Prob_Shift {5}; // smaller => more adaptive
 
-// variables
+// functions
 
-static std::array<int, Move_Index_Size> G_Hist;
+void Killer::clear() {
 
-// functions
+   for (auto & killer : m_killer) {
+      killer.fill(Move_Index_None);
+   }
+
+   m_counter.fill(Move_Index_None);
+}
+
+void Killer::add(Move mv, const Pos & pos, Ply ply, Move_Index prev) {
+
+   assert(ply >= 0 && ply < Killer_Ply_Size);
+
+   Move_Index index = move::index(mv, pos);
+
+   if (m_killer[ply][0] != index) {
+      m_killer[ply][1] = m_killer[ply][0];
+      m_killer[ply][0] = index;
+   }
+
+   if (prev != Move_Index_None) m_counter[prev] = index;
+}
+
+void History::clear() {
+   m_prob.fill(Prob_Half);
+}
 
-void sort_clear() {
-   G_Hist.fill(Prob_Half);
+void History::merge(const History & hist, int n) { // running average, hist is the n-th table
+
+   assert(n > 0);
+
+   for (int i = 0; i < Move_Index_Size; i++) {
+      m_prob[i] += (hist.m_prob[i] - m_prob[i]) / n;
+   }
 }
 
-void good_move(Move mv, const Pos & pos) {
+void History::good_move(Move mv, const Pos & pos) {
    Move_Index index = move::index(mv, pos);
-   G_Hist[index] += (Prob_One - G_Hist[index]) >> Prob_Shift;
+   m_prob[index] += (Prob_One - m_prob[index]) >> Prob_Shift;
 }
 
-void bad_move(Move mv, const Pos & pos) {
+void History::bad_move(Move mv, const Pos & pos) {
    Move_Index index = move::index(mv, pos);
-   G_Hist[index] -= G_Hist[index] >> Prob_Shift;
+   m_prob[index] -= m_prob[index] >> Prob_Shift;
 }
 
-void sort_moves(List & list, const Pos & pos, Move_Index tt_move) {
+void History::sort_moves(List & list, const Pos & pos, Move_Index tt_move, const Killer & killer, Ply ply, Move_Index prev) const {
 
    if (list.size() <= 1) return;
 
+   // TT move > killers > counter move > history
+
+   Move_Index killer_0 = killer.killer(ply, 0);
+   Move_Index killer_1 = killer.killer(ply, 1);
+   Move_Index counter  = (prev != Move_Index_None) ? killer.counter(prev) : Move_Index_None;
+
    for (int i = 0; i < list.size(); i++) {
 
       Move mv = list[i];
       Move_Index index = move::index(mv, pos);
 
-      int sc = (index == tt_move) ? Prob_One - 1 : G_Hist[index];
-      assert(sc >= 0 && sc < Prob_One);
+      int sc;
+
+      if (false) {
+      } else if (index == tt_move) {
+         sc = Prob_One + 3;
+      } else if (index == killer_0) {
+         sc = Prob_One + 2;
+      } else if (index == killer_1) {
+         sc = Prob_One + 1;
+      } else if (index == counter) {
+         sc = Prob_One;
+      } else {
+         sc = m_prob[index];
+         assert(sc >= 0 && sc < Prob_One);
+      }
 
       list.set_score(i, sc);
    }
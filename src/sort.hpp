@@ -4,20 +4,53 @@
 
 // includes
 
+#include <array>
+
 #include "common.hpp"
 #include "libmy.hpp"
 
 class List;
 class Pos;
 
-// functions
+// constants
+
+const int Killer_Ply_Size {100}; // at least the search ply limit
+
+// types
+
+class Killer { // one per thread, never merged
+
+private:
+
+   std::array<std::array<Move_Index, 2>, Killer_Ply_Size> m_killer;
+   std::array<Move_Index, Move_Index_Size> m_counter; // indexed by the opponent's last move
+
+public:
+
+   void clear ();
+
+   void add (Move mv, const Pos & pos, Ply ply, Move_Index prev); // quiet fail high
+
+   Move_Index killer  (Ply ply, int slot) const { return m_killer[ply][slot]; }
+   Move_Index counter (Move_Index prev)   const { return m_counter[prev]; }
+};
+
+class History { // one per thread
+
+private:
+
+   std::array<int, Move_Index_Size> m_prob;
+
+public:
 
-void sort_clear ();
+   void clear ();
+   void merge (const History & hist, int n);
 
-void good_move (Move mv, const Pos & pos);
-void bad_move  (Move mv, const Pos & pos);
+   void good_move (Move mv, const Pos & pos);
+   void bad_move  (Move mv, const Pos & pos);
 
-void sort_moves (List & list, const Pos & pos, Move_Index tt_move);
+   void sort_moves (List & list, const Pos & pos, Move_Index tt_move, const Killer & killer, Ply ply, Move_Index prev) const;
+};
 
 #endif // !defined SORT_HPP
 
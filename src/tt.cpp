@@ -68,7 +68,7 @@ void TT::store(Key key, Move_Index move, Score score, Flag flag, Depth depth) {
    assert(move >= 0 && move < (1 << 16));
    assert(score != score::None);
    assert(std::abs(score) < (1 << 15));
-   assert(depth > 0 && depth < (1 << 8));
+   assert(depth >= Depth_QS && depth < (1 << 8));
 
    // probe
 
@@ -119,6 +119,8 @@ void TT::store(Key key, Move_Index move, Score score, Flag flag, Depth depth) {
 
    assert(be != nullptr);
    Entry & entry = *be;
+
+   if (depth == Depth_QS && m_age[entry.date] == 0 && entry.depth > Depth_QS) return; // keep deep entries of the current search
    // assert(entry.lock != lock); // triggers in SMP
 
    // store
@@ -9,6 +9,10 @@
 #include "common.hpp"
 #include "libmy.hpp"
 
+// constants
+
+const Depth Depth_QS {Depth(0)}; // quiescence-search entries
+
 // types
 
 enum class Flag : int {
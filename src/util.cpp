@@ -1,22 +1,232 @@
 
 // includes
 
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#if defined _MSC_VER && defined _M_X64
+#include <intrin.h>
+#define TSC
+#elif defined __x86_64__
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TSC
+#endif
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
 #include "libmy.hpp"
 #include "util.hpp"
 
+// variables
+
+static bool G_TSC {false};
+static uint64 G_TSC_Start;
+static uint64 G_Steady_Start;
+static std::atomic<double> G_Tick_Time {1E-9}; // seconds per tick
+static std::atomic<bool> G_Tick_Done {false}; // calibrated
+
+// prototypes
+
+static uint64 steady_tick ();
+static double tick_rate   ();
+
+#ifdef TSC
+static bool tsc_is_invariant ();
+#endif
+
 // functions
 
+void tick_init() {
+
+#ifdef TSC
+
+   if (!tsc_is_invariant()) return; // keep steady_clock
+
+   // calibrated lazily against steady_clock (see "tick_rate")
+
+   G_Steady_Start = steady_tick();
+   G_TSC_Start = __rdtsc();
+
+   G_TSC = true;
+
+#endif
+}
+
+uint64 tick() {
+
+#ifdef TSC
+   if (G_TSC) return __rdtsc();
+#endif
+
+   return steady_tick();
+}
+
+double tick_time(uint64 ticks) {
+   return double(ticks) * tick_rate();
+}
+
+bool tick_is_tsc() {
+   return G_TSC;
+}
+
+static uint64 steady_tick() { // nanoseconds
+   auto time = std::chrono::steady_clock::now().time_since_epoch();
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+static double tick_rate() { // seconds per tick, measured over the time elapsed since "tick_init"
+
+#ifdef TSC
+
+   if (G_TSC && !G_Tick_Done.load(std::memory_order_acquire)) {
+
+      uint64 s = steady_tick();
+      uint64 t = __rdtsc();
+
+      if (t > G_TSC_Start && s > G_Steady_Start) {
+         G_Tick_Time.store(double(s - G_Steady_Start) * 1E-9 / double(t - G_TSC_Start), std::memory_order_relaxed);
+         if (s - G_Steady_Start >= 100000000) G_Tick_Done.store(true, std::memory_order_release); // 0.1 s is precise enough
+      }
+   }
+
+#endif
+
+   return G_Tick_Time.load(std::memory_order_relaxed);
+}
+
+#ifdef TSC
+
+static bool tsc_is_invariant() { // constant rate across P-states and cores
+
+#ifdef _MSC_VER
+   int reg[4];
+   __cpuid(reg, 0x80000000);
+   if (unsigned(reg[0]) < 0x80000007) return false;
+   __cpuid(reg, 0x80000007);
+   return (reg[3] & (1 << 8)) != 0;
+#else
+   unsigned eax, ebx, ecx, edx;
+   if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) return false; // leaf not supported
+   return (edx & (1 << 8)) != 0;
+#endif
+}
+
+#endif
+
 void load_file(std::vector<uint8> & table, std::istream & file) {
    int64 size = ml::stream_size(file);
    table.resize(size);
    file.read((char *) table.data(), size);
 }
 
+File_Map::~File_Map() {
+   close();
+}
+
+bool File_Map::open(const std::string & file_name) {
+
+   close();
+
+#ifdef _WIN32
+
+   HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+   if (file == INVALID_HANDLE_VALUE) return false;
+
+   LARGE_INTEGER size;
+
+   if (!GetFileSizeEx(file, &size)) {
+      CloseHandle(file);
+      return false;
+   }
+
+   if (size.QuadPart != 0) {
+
+      HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+      if (map == nullptr) {
+         CloseHandle(file);
+         return false;
+      }
+
+      void * data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(map); // the view keeps the mapping alive
+
+      if (data == nullptr) {
+         CloseHandle(file);
+         return false;
+      }
+
+      m_data = static_cast<const uint8 *>(data);
+      m_size = size.QuadPart;
+   }
+
+   CloseHandle(file);
+
+#else
+
+   int fd = ::open(file_name.c_str(), O_RDONLY);
+   if (fd < 0) return false;
+
+   struct stat st;
+
+   if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      return false;
+   }
+
+   if (st.st_size != 0) {
+
+      void * data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+      if (data == MAP_FAILED) {
+         ::close(fd);
+         return false;
+      }
+
+      madvise(data, st.st_size, MADV_RANDOM); // probes don't benefit from read-ahead
+
+      m_data = static_cast<const uint8 *>(data);
+      m_size = st.st_size;
+   }
+
+   ::close(fd); // the mapping stays valid
+
+#endif
+
+   return true;
+}
+
+void File_Map::close() {
+
+#ifdef _WIN32
+   if (m_data != nullptr) UnmapViewOfFile(m_data);
+#else
+   if (m_data != nullptr) munmap(const_cast<uint8 *>(m_data), m_size);
+#endif
+
+   m_data = nullptr;
+   m_size = 0;
+}
+
 Scanner_Number::Scanner_Number(const std::string & s) : m_string{s} {}
 
 std::string Scanner_Number::get_token() {
@@ -60,6 +270,33 @@ void Scanner_Number::unget_char() {
    m_pos--;
 }
 
+bool make_dir(const std::string & dir_name) { // true if it exists afterwards
+
+#ifdef _WIN32
+   _mkdir(dir_name.c_str());
+#else
+   mkdir(dir_name.c_str(), 0777);
+#endif
+
+   struct stat info;
+   return stat(dir_name.c_str(), &info) == 0 && (info.st_mode & S_IFDIR) != 0;
+}
+
+int64 peak_memory() { // resident set, 0 if unknown
+
+#ifdef _WIN32
+   return 0;
+#else
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+   return int64(usage.ru_maxrss); // bytes
+#else
+   return int64(usage.ru_maxrss) * 1024; // KiB
+#endif
+#endif
+}
+
 bool string_is_nat(const std::string & s) {
 
    for (char c : s) {
@@ -39,7 +39,7 @@ class Timer {
 
 private:
 
-   using time_t   = std::chrono::time_point<std::chrono::system_clock>;
+   using time_t   = std::chrono::time_point<std::chrono::steady_clock>; // monotonic
    using second_t = std::chrono::duration<double>;
 
    double m_elapsed {0.0};
@@ -72,7 +72,7 @@ public:
 private:
 
    static time_t now() {
-      return std::chrono::system_clock::now();
+      return std::chrono::steady_clock::now();
    }
 
    double time() const {
@@ -81,10 +81,42 @@ private:
    }
 };
 
+class File_Map { // read-only file mapped in memory, pages are loaded on demand
+
+private:
+
+   const uint8 * m_data {nullptr};
+   int64 m_size {0};
+
+public:
+
+   File_Map () = default;
+   File_Map (const File_Map &) = delete;
+   ~File_Map ();
+
+   File_Map & operator = (const File_Map &) = delete;
+
+   bool open  (const std::string & file_name);
+   void close ();
+
+   const uint8 * data () const { return m_data; }
+   int64         size () const { return m_size; }
+};
+
 // functions
 
+void tick_init ();
+
+uint64 tick      (); // cheap monotonic counter for hot paths (TSC if usable)
+double tick_time (uint64 ticks); // in seconds
+
+bool tick_is_tsc ();
+
 void load_file (std::vector<uint8> & table, std::istream & file);
 
+bool  make_dir    (const std::string & dir_name);
+int64 peak_memory (); // bytes
+
 bool string_is_nat (const std::string & s);
 
 #endif // !defined UTIL_HPP
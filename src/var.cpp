@@ -22,9 +22,16 @@ int  Book_Margin;
 bool Ponder;
 bool SMP;
 int  Threads;
+bool Root_Split;
 int  TT_Size;
+bool TT_QS;
+bool Killers;
+bool Deterministic;
 bool BB;
 int  BB_Size;
+bool BB_SIMD;
+int  BB_Cache;
+int  BB_Hash;
 
 bool DXP_Server;
 std::string DXP_Host;
@@ -52,8 +59,15 @@ void init() {
    set("book-margin", "4");
    set("ponder", "false");
    set("threads", "1");
+   set("root-split", "false");
    set("tt-size", "24");
+   set("tt-qs", "false");
+   set("killers", "false");
+   set("deterministic", "false");
    set("bb-size", "5");
+   set("bb-simd", "false");
+   set("bb-cache", "0");
+   set("bb-hash", "0");
 
    set("dxp-server", "true");
    set("dxp-host", "127.0.0.1");
@@ -142,9 +156,16 @@ void update() {
    Ponder      = get_bool("ponder");
    Threads     = get_int("threads");
    SMP         = Threads > 1;
+   Root_Split  = get_bool("root-split");
    TT_Size     = 1 << get_int("tt-size");
+   TT_QS       = get_bool("tt-qs");
+   Killers     = get_bool("killers");
+   Deterministic = get_bool("deterministic");
    BB_Size     = get_int("bb-size");
    BB          = BB_Size > 0;
+   BB_SIMD     = get_bool("bb-simd");
+   BB_Cache    = get_int("bb-cache");
+   BB_Hash     = get_int("bb-hash");
 
    DXP_Server    = get_bool("dxp-server");
    DXP_Host      = get("dxp-host");
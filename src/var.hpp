@@ -23,9 +23,16 @@ extern int  Book_Margin;
 extern bool Ponder;
 extern bool SMP;
 extern int  Threads;
+extern bool Root_Split;
 extern int  TT_Size;
+extern bool TT_QS;
+extern bool Killers;
+extern bool Deterministic;
 extern bool BB;
 extern int  BB_Size;
+extern bool BB_SIMD;
+extern int  BB_Cache;
+extern int  BB_Hash;
 
 extern bool DXP_Server;
 extern std::string DXP_Host;